@@ -5,6 +5,11 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <iostream>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <time.h>
+#include <vector>
 #include "llvm-c/Core.h"
 
 #include "llvm/IR/LLVMContext.h"
@@ -12,30 +17,51 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/ScopedHashTable.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/LinkAllPasses.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/RecyclingAllocator.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/BasicAliasAnalysis.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TypeBasedAliasAnalysis.h"
 
 using namespace llvm;
 
-static void CommonSubexpressionElimination(Module *);
 static bool isDead(Instruction &);
-static void summarize(Module *M);
-static void print_csv_file(std::string outputfile);
-static void PrintInstructions(Module *);
-static cl::opt<std::string>
-        InputFilename(cl::Positional, cl::desc("<input bitcode>"), cl::Required, cl::init("-"));
+static cl::list<std::string>
+        Filenames(cl::Positional, cl::desc("<input bitcode> <output bitcode>..."), cl::ZeroOrMore);
 
 static cl::opt<std::string>
-        OutputFilename(cl::Positional, cl::desc("<output bitcode>"), cl::Required, cl::init("out.bc"));
+        ManifestFilename("manifest",
+                         cl::desc("Read <input bitcode> <output bitcode> pairs, one per line, from <file>."),
+                         cl::value_desc("file"),
+                         cl::init(""));
 
 static cl::opt<bool>
         Mem2Reg("mem2reg",
@@ -52,146 +78,1016 @@ static cl::opt<bool>
                     cl::desc("Verbose stats."),
                     cl::init(false));
 
+static cl::opt<unsigned>
+        Jobs("j",
+             cl::desc("Optimize independent functions, or with several modules independent modules, on N threads (0: one per core)."),
+             cl::value_desc("N"),
+             cl::init(1));
+
 static cl::opt<bool>
         NoCheck("no",
                 cl::desc("Do not check for valid IR."),
                 cl::init(false));
 
-int main(int argc, char **argv) {
-    // Parse command line arguments
-    cl::ParseCommandLineOptions(argc, argv, "llvm system compiler\n");
+static cl::opt<std::string>
+        TraceFilename("trace",
+                      cl::desc("Write a Chrome trace-event JSON of the phases to <file>."),
+                      cl::value_desc("file"),
+                      cl::init(""));
 
-    // Handle creating output files and shutting down properly
-    llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+namespace {
+// Wall-clock and CPU time spent in one phase, in microseconds.
+struct PhaseTime {
+    uint64_t Wall = 0;
+    uint64_t CPU = 0;
+
+    PhaseTime &operator+=(const PhaseTime &RHS) {
+        Wall += RHS.Wall;
+        CPU += RHS.CPU;
+        return *this;
+    }
+};
+}
+
+static uint64_t wallMicros() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t cpuMicros(clockid_t Clock) {
+    timespec TS;
+    clock_gettime(Clock, &TS);
+    return uint64_t(TS.tv_sec) * 1000000 + TS.tv_nsec / 1000;
+}
+
+namespace {
+// Adds the wall-clock and CPU time of the enclosing scope to a PhaseTime
+// and, with -trace, records the scope as a trace event. The phases of a
+// module with a parallel CSE charge the CPU time of the whole process, so
+// they count all of its workers; other spans charge only their own thread.
+class PhaseTimer {
+    PhaseTime &Into;
+    clockid_t Clock;
+    uint64_t WallStart;
+    uint64_t CPUStart;
+    TimeTraceScope Trace;
+
+public:
+    PhaseTimer(PhaseTime &Into, StringRef Name, StringRef Detail = "",
+               clockid_t Clock = CLOCK_PROCESS_CPUTIME_ID)
+        : Into(Into), Clock(Clock), WallStart(wallMicros()),
+          CPUStart(cpuMicros(Clock)), Trace(Name, Detail) {}
+
+    ~PhaseTimer() {
+        Into.Wall += wallMicros() - WallStart;
+        Into.CPU += cpuMicros(Clock) - CPUStart;
+    }
+};
+}
+
+namespace {
+// What the .stats file of one output reports: the nonzero counts of the
+// module, which it writes sorted by name, and the time of each phase, in
+// the order the phases first ran. The Statistics are shared by all modules of
+// the run, so each module keeps its own copy of its counts. Times is a
+// deque so that a running PhaseTimer keeps its entry when phases are added.
+struct ModuleStats {
+    std::vector<std::pair<StringRef, uint64_t>> Counts;
+    std::deque<std::pair<StringRef, PhaseTime>> Times;
+
+    // Add N to S, which -verbose prints summed over all modules, and to
+    // this module's count of the same name.
+    void add(TrackingStatistic &S, uint64_t N) {
+        if (N == 0)
+            return;
+        S += N;
+        for (auto &C : Counts)
+            if (C.first == S.getName()) {
+                C.second += N;
+                return;
+            }
+        Counts.emplace_back(S.getName(), N);
+    }
+
+    PhaseTime &phaseTime(StringRef Name) {
+        for (auto &P : Times)
+            if (P.first == Name)
+                return P.second;
+        Times.emplace_back(Name, PhaseTime());
+        return Times.back().second;
+    }
+};
+
+// One input/output pair of the run. Diagnostics are buffered so that
+// modules processed in parallel report in the order they were given.
+struct ModuleJob {
+    std::string Input;
+    std::string Output;
+    ModuleStats Stats;
+    std::string Diagnostics;
+    bool Failed = false;
+
+    ModuleJob(StringRef Input, StringRef Output) : Input(Input), Output(Output) {}
+};
+}
+
+static void CommonSubexpressionElimination(Module *, ModuleStats &, unsigned);
+static void summarize(Module *M, ModuleStats &Stats);
+static void print_csv_file(std::string outputfile, const ModuleStats &Stats);
+
+// Collect the input/output pairs of the run, first those on the command
+// line and then those of the -manifest file. Blank lines and lines
+// starting with '#' in the manifest are ignored.
+static bool readModuleList(const char *Argv0, std::vector<ModuleJob> &Modules) {
+    if (Filenames.size() % 2 != 0) {
+        errs() << Argv0 << ": expected pairs of <input bitcode> <output bitcode>\n";
+        return false;
+    }
+    for (size_t i = 0; i < Filenames.size(); i += 2)
+        Modules.emplace_back(Filenames[i], Filenames[i + 1]);
+
+    if (!ManifestFilename.empty()) {
+        ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+                MemoryBuffer::getFile(ManifestFilename);
+        if (std::error_code EC = Buffer.getError()) {
+            errs() << Argv0 << ": " << ManifestFilename << ": " << EC.message() << "\n";
+            return false;
+        }
+        for (line_iterator Line(**Buffer, true, '#'); !Line.is_at_eof(); ++Line) {
+            StringRef Input, Output, Rest;
+            std::tie(Input, Rest) = getToken(*Line);
+            std::tie(Output, Rest) = getToken(Rest);
+            if (Output.empty() || !Rest.trim().empty()) {
+                errs() << ManifestFilename << ":" << Line.line_number()
+                       << ": expected <input bitcode> <output bitcode>\n";
+                return false;
+            }
+            Modules.emplace_back(Input, Output);
+        }
+    }
+
+    if (Modules.empty()) {
+        errs() << Argv0 << ": no <input bitcode> <output bitcode> given\n";
+        return false;
+    }
+    return true;
+}
+
+// Read, optimize and write one module. Every module gets an LLVMContext of
+// its own, so modules share no IR state and can be processed on separate
+// threads. The CSE of the module runs on FunctionJobs threads.
+static void optimizeModule(ModuleJob &MJ, unsigned FunctionJobs, const char *Argv0) {
+    ModuleStats &Stats = MJ.Stats;
+    raw_string_ostream Diagnostics(MJ.Diagnostics);
+    const clockid_t Clock =
+            FunctionJobs == 1 ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID;
+    TimeTraceScope Span("optimizeModule", MJ.Input);
     LLVMContext Context;
 
     // LLVM idiom for constructing output file.
-    std::unique_ptr<ToolOutputFile> Out;
-    std::string ErrorInfo;
     std::error_code EC;
-    Out.reset(new ToolOutputFile(OutputFilename.c_str(), EC,
-                                 sys::fs::OF_None));
-
-    EnableStatistics();
+    ToolOutputFile Out(MJ.Output, EC, sys::fs::OF_None);
+    if (EC) {
+        Diagnostics << Argv0 << ": " << MJ.Output << ": " << EC.message() << "\n";
+        MJ.Failed = true;
+        return;
+    }
 
     // Read in module
     SMDiagnostic Err;
     std::unique_ptr<Module> M;
-    M = parseIRFile(InputFilename, Err, Context);
+    {
+        PhaseTimer Timer(Stats.phaseTime("parseIRFile"), "parseIRFile", MJ.Input, Clock);
+        M = parseIRFile(MJ.Input, Err, Context);
+    }
 
     // If errors, fail
     if (M.get() == 0)
     {
-        Err.print(argv[0], errs());
-        return 1;
+        Err.print(Argv0, Diagnostics);
+        MJ.Failed = true;
+        return;
     }
 
     // If requested, do some early optimizations
     if (Mem2Reg)
     {
+        PhaseTimer Timer(Stats.phaseTime("mem2reg"), "mem2reg", "", Clock);
         legacy::PassManager Passes;
         Passes.add(createPromoteMemoryToRegisterPass());
         Passes.run(*M.get());
     }
 
     if (!NoCSE) {
-        CommonSubexpressionElimination(M.get());
+        PhaseTimer Timer(Stats.phaseTime("CSE"), "CSE", "", Clock);
+        CommonSubexpressionElimination(M.get(), Stats, FunctionJobs);
     }
 
     // Collect statistics on Module
-    summarize(M.get());
-    print_csv_file(OutputFilename);
-
-    if (Verbose)
-        PrintStatistics(errs());
+    {
+        PhaseTimer Timer(Stats.phaseTime("summarize"), "summarize", "", Clock);
+        summarize(M.get(), Stats);
+    }
 
     // Verify integrity of Module, do this by default
     if (!NoCheck)
     {
+        PhaseTimer Timer(Stats.phaseTime("verifier"), "verifier", "", Clock);
         legacy::PassManager Passes;
         Passes.add(createVerifierPass());
         Passes.run(*M.get());
     }
 
     // Write final bitcode
-    WriteBitcodeToFile(*M.get(), Out->os());
-    Out->keep();
+    {
+        PhaseTimer Timer(Stats.phaseTime("WriteBitcodeToFile"), "WriteBitcodeToFile", "", Clock);
+        WriteBitcodeToFile(*M.get(), Out.os());
+    }
+    Out.keep();
 
-    return 0;
+    // The stats go out last so that they include the time of every phase.
+    print_csv_file(MJ.Output, Stats);
 }
 
-static llvm::Statistic nFunctions = {"", "Functions", "number of functions"};
-static llvm::Statistic nInstructions = {"", "Instructions", "number of instructions"};
-static llvm::Statistic nLoads = {"", "Loads", "number of loads"};
-static llvm::Statistic nStores = {"", "Stores", "number of stores"};
+int main(int argc, char **argv) {
+    // Parse command line arguments
+    cl::ParseCommandLineOptions(argc, argv, "llvm system compiler\n");
+
+    // Handle creating output files and shutting down properly
+    llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+
+    std::vector<ModuleJob> Modules;
+    if (!readModuleList(argv[0], Modules))
+        return 1;
+
+    EnableStatistics();
+    if (!TraceFilename.empty())
+        timeTraceProfilerInitialize(0, argv[0]);
+
+    // A single module spends -j on its functions; several modules are
+    // processed -j at a time, each with a serial CSE.
+    uint64_t Start = wallMicros();
+    if (Modules.size() == 1) {
+        optimizeModule(Modules[0], Jobs, argv[0]);
+    } else if (Jobs == 1) {
+        for (ModuleJob &MJ : Modules)
+            optimizeModule(MJ, 1, argv[0]);
+    } else {
+        bool Trace = timeTraceProfilerEnabled();
+        ThreadPool Pool(hardware_concurrency(Jobs));
+        for (ModuleJob &MJ : Modules)
+            Pool.async([&] {
+                if (Trace)
+                    timeTraceProfilerInitialize(0, argv[0]);
+                optimizeModule(MJ, 1, argv[0]);
+                if (Trace)
+                    timeTraceProfilerFinishThread();
+            });
+        Pool.wait();
+    }
+    uint64_t Elapsed = wallMicros() - Start;
 
-static void summarize(Module *M) {
+    bool Failed = false;
+    for (ModuleJob &MJ : Modules) {
+        errs() << MJ.Diagnostics;
+        Failed |= MJ.Failed;
+    }
+
+    if (Verbose)
+        PrintStatistics(errs());
+
+    if (Modules.size() > 1) {
+        double Seconds = Elapsed / 1e6;
+        errs() << format("%s: %zu modules in %.3f s (%.1f modules/s)\n", argv[0],
+                         Modules.size(), Seconds,
+                         Seconds > 0 ? Modules.size() / Seconds : 0.0);
+    }
+
+    if (!TraceFilename.empty()) {
+        if (Error E = timeTraceProfilerWrite(TraceFilename, Modules[0].Output))
+            logAllUnhandledErrors(std::move(E), errs(), "p2: ");
+        timeTraceProfilerCleanup();
+    }
+
+    return Failed ? 1 : 0;
+}
+
+// The statistics are always tracked, as they make up the .stats files.
+static llvm::TrackingStatistic nFunctions = {"", "Functions", "number of functions"};
+static llvm::TrackingStatistic nInstructions = {"", "Instructions", "number of instructions"};
+static llvm::TrackingStatistic nLoads = {"", "Loads", "number of loads"};
+static llvm::TrackingStatistic nStores = {"", "Stores", "number of stores"};
+
+static void summarize(Module *M, ModuleStats &Stats) {
+    unsigned Functions = 0, Instructions = 0, Loads = 0, Stores = 0;
     for (auto i = M->begin(); i != M->end(); i++) {
         if (i->begin() != i->end()) {
-            nFunctions++;
+            Functions++;
         }
 
         for (auto j = i->begin(); j != i->end(); j++) {
             for (auto k = j->begin(); k != j->end(); k++) {
                 Instruction &I = *k;
-                nInstructions++;
+                Instructions++;
                 if (isa<LoadInst>(&I)) {
-                    nLoads++;
+                    Loads++;
                 } else if (isa<StoreInst>(&I)) {
-                    nStores++;
+                    Stores++;
                 }
             }
         }
     }
+    Stats.add(nFunctions, Functions);
+    Stats.add(nInstructions, Instructions);
+    Stats.add(nLoads, Loads);
+    Stats.add(nStores, Stores);
 }
 
-static void print_csv_file(std::string outputfile)
+static void print_csv_file(std::string outputfile, const ModuleStats &Stats)
 {
     std::ofstream stats(outputfile + ".stats");
-    auto a = GetStatistics();
-    for (auto p : a) {
+    // By name, as PrintStatistics orders them, so the rows do not depend
+    // on which stage happened to count first.
+    std::vector<std::pair<StringRef, uint64_t>> Counts = Stats.Counts;
+    std::sort(Counts.begin(), Counts.end());
+    for (auto &p : Counts) {
         stats << p.first.str() << "," << p.second << std::endl;
     }
+    for (auto &P : Stats.Times) {
+        stats << "Time." << P.first.str() << ".WallUs," << P.second.Wall << std::endl;
+        stats << "Time." << P.first.str() << ".CPUUs," << P.second.CPU << std::endl;
+    }
     stats.close();
 }
 
-static llvm::Statistic CSEDead = {"", "CSEDead", "CSE found dead instructions"};
-static llvm::Statistic CSEElim = {"", "CSEElim", "CSE redundant instructions"};
-static llvm::Statistic CSESimplify = {"", "CSESimplify", "CSE simplified instructions"};
-static llvm::Statistic CSELdElim = {"", "CSELdElim", "CSE redundant loads"};
-static llvm::Statistic CSEStore2Load = {"", "CSEStore2Load", "CSE forwarded store to load"};
-static llvm::Statistic CSEStElim = {"", "CSEStElim", "CSE redundant stores"};
+static llvm::TrackingStatistic CSEDead = {"", "CSEDead", "CSE found dead instructions"};
+static llvm::TrackingStatistic CSEElim = {"", "CSEElim", "CSE redundant instructions"};
+static llvm::TrackingStatistic CSEElimDom = {"", "CSEElimDom", "CSE redundant instructions in dominated blocks"};
+static llvm::TrackingStatistic CSESimplify = {"", "CSESimplify", "CSE simplified instructions"};
+static llvm::TrackingStatistic CSELdElim = {"", "CSELdElim", "CSE redundant loads"};
+static llvm::TrackingStatistic CSEStore2Load = {"", "CSEStore2Load", "CSE forwarded store to load"};
+static llvm::TrackingStatistic CSEStElim = {"", "CSEStElim", "CSE redundant stores"};
 
-static void CommonSubexpressionElimination(Module *M) {
-    // Implement this function
-	std::set<Instruction*> dead_inst_list;
-	std::cout << " I am here " << std::endl;
-	// printing the instructions 
+namespace {
+// Counts of one function's pipeline run. Workers fill their own copy,
+// which is added to the Statistics after all workers are done, so the hot
+// loops never share a counter.
+struct CSECounts {
+    unsigned Dead = 0;
+    unsigned Elim = 0;
+    unsigned ElimDom = 0;
+    unsigned Simplify = 0;
+    unsigned LdElim = 0;
+    unsigned Store2Load = 0;
+    unsigned StElim = 0;
+};
+
+// Time of the stages of one function's pipeline run, summed over the
+// stages that run twice.
+struct CSETimes {
+    PhaseTime DCE;
+    PhaseTime Analysis;
+    PhaseTime Simplify;
+    PhaseTime ValueNumbering;
+    PhaseTime DeadStores;
+};
+
+// State of one function's pipeline run. Deleting an instruction updates
+// maps in the shared LLVMContext, so workers only unlink erased
+// instructions and park them in Removed; finishRun deletes them on the
+// main thread.
+//
+// ContextMutex guards state that all functions of the module share
+// through its LLVMContext: the uniqued constants and types that folding
+// creates, the use lists of constants and globals, and the value-handle
+// map. Everything else a worker touches is local to its own function.
+struct FunctionRun {
+    CSECounts Counts;
+    CSETimes Times;
+    SmallVector<Instruction *, 32> Removed;
+    std::mutex &ContextMutex;
+
+    explicit FunctionRun(std::mutex &ContextMutex) : ContextMutex(ContextMutex) {}
+};
+}
+
+// Unlink I and drop its operands. The caller holds ContextMutex.
+static void removeInstruction(Instruction *I, FunctionRun &Run) {
+    I->dropAllReferences();
+    I->removeFromParent();
+    Run.Removed.push_back(I);
+}
+
+// Replace the uses of I, which are all in I's function, by V. That only
+// reaches the shared context when V is a constant, whose use list it
+// extends, or when I has value handles or metadata uses, which the
+// context tracks; only then does it take ContextMutex.
+static void replaceUses(Instruction &I, Value *V, FunctionRun &Run) {
+    if (isa<Constant>(V) || I.hasValueHandle() || I.isUsedByMetadata()) {
+        std::lock_guard<std::mutex> Lock(Run.ContextMutex);
+        I.replaceAllUsesWith(V);
+    } else {
+        I.replaceAllUsesWith(V);
+    }
+}
+
+static void finishRun(FunctionRun &Run, ModuleStats &Stats) {
+    for (Instruction *I : Run.Removed)
+        I->deleteValue();
+    Run.Removed.clear();
+
+    Stats.add(CSEDead, Run.Counts.Dead);
+    Stats.add(CSEElim, Run.Counts.Elim);
+    Stats.add(CSEElimDom, Run.Counts.ElimDom);
+    Stats.add(CSESimplify, Run.Counts.Simplify);
+    Stats.add(CSELdElim, Run.Counts.LdElim);
+    Stats.add(CSEStore2Load, Run.Counts.Store2Load);
+    Stats.add(CSEStElim, Run.Counts.StElim);
+
+    Stats.phaseTime("CSE.DCE") += Run.Times.DCE;
+    Stats.phaseTime("CSE.Analysis") += Run.Times.Analysis;
+    Stats.phaseTime("CSE.Simplify") += Run.Times.Simplify;
+    Stats.phaseTime("CSE.ValueNumbering") += Run.Times.ValueNumbering;
+    Stats.phaseTime("CSE.DeadStores") += Run.Times.DeadStores;
+}
+
+namespace {
+// The value-numbering key of a pure instruction. Two instructions with
+// equal Expressions compute the same value, so the later one is redundant.
+struct Expression {
+    unsigned Opcode;
+    Type *Ty;
+    Type *SrcTy;               // GEP source element type
+    unsigned Predicate;        // compare predicate, 0 otherwise
+    unsigned Flags;            // nuw/nsw/exact/inbounds/fast-math bits
+    SmallVector<Value *, 4> Operands;
+    SmallVector<int, 4> Extra; // aggregate indices or shuffle mask
+
+    explicit Expression(unsigned Opcode = ~0U)
+        : Opcode(Opcode), Ty(nullptr), SrcTy(nullptr), Predicate(0), Flags(0) {}
+
+    bool operator==(const Expression &O) const {
+        return Opcode == O.Opcode && Ty == O.Ty && SrcTy == O.SrcTy &&
+               Predicate == O.Predicate && Flags == O.Flags &&
+               Operands == O.Operands && Extra == O.Extra;
+    }
+};
+}
+
+namespace llvm {
+template <> struct DenseMapInfo<Expression> {
+    static Expression getEmptyKey() { return Expression(~0U); }
+    static Expression getTombstoneKey() { return Expression(~1U); }
+    static unsigned getHashValue(const Expression &E) {
+        return hash_combine(E.Opcode, E.Ty, E.SrcTy, E.Predicate, E.Flags,
+                            hash_combine_range(E.Operands.begin(), E.Operands.end()),
+                            hash_combine_range(E.Extra.begin(), E.Extra.end()));
+    }
+    static bool isEqual(const Expression &L, const Expression &R) { return L == R; }
+};
+}
+
+// Only instructions without side effects or memory dependences can be
+// value numbered.
+static bool canValueNumber(Instruction &I) {
+    return isa<BinaryOperator>(I) || isa<UnaryOperator>(I) || isa<CastInst>(I) ||
+           isa<CmpInst>(I) || isa<GetElementPtrInst>(I) || isa<SelectInst>(I) ||
+           isa<ExtractElementInst>(I) || isa<InsertElementInst>(I) ||
+           isa<ShuffleVectorInst>(I) || isa<ExtractValueInst>(I) ||
+           isa<InsertValueInst>(I);
+}
+
+static Expression getExpression(Instruction &I) {
+    Expression E(I.getOpcode());
+    E.Ty = I.getType();
+    E.Flags = I.getRawSubclassOptionalData();
+    for (Value *Op : I.operands())
+        E.Operands.push_back(Op);
+
+    // Put commutative operands in a canonical order so that a+b and b+a
+    // (or a<b and b>a) get the same key.
+    std::less<Value *> Before;
+    if (CmpInst *C = dyn_cast<CmpInst>(&I)) {
+        CmpInst::Predicate P = C->getPredicate();
+        if (Before(E.Operands[1], E.Operands[0])) {
+            std::swap(E.Operands[0], E.Operands[1]);
+            P = CmpInst::getSwappedPredicate(P);
+        }
+        E.Predicate = P;
+    } else if (I.isCommutative() && Before(E.Operands[1], E.Operands[0])) {
+        std::swap(E.Operands[0], E.Operands[1]);
+    }
+
+    if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(&I))
+        E.SrcTy = GEP->getSourceElementType();
+    else if (ExtractValueInst *EV = dyn_cast<ExtractValueInst>(&I))
+        E.Extra.append(EV->idx_begin(), EV->idx_end());
+    else if (InsertValueInst *IV = dyn_cast<InsertValueInst>(&I))
+        E.Extra.append(IV->idx_begin(), IV->idx_end());
+    else if (ShuffleVectorInst *SV = dyn_cast<ShuffleVectorInst>(&I))
+        E.Extra.append(SV->getShuffleMask().begin(), SV->getShuffleMask().end());
+
+    return E;
+}
+
+typedef ScopedHashTable<Expression, Instruction *, DenseMapInfo<Expression>,
+                        RecyclingAllocator<BumpPtrAllocator,
+                                           ScopedHashTableVal<Expression, Instruction *>>>
+        ExpressionTable;
+
+namespace {
+// A value in memory that is available for reuse: either the result of a
+// load or the value written by a store. Generation is the length of the
+// clobber log when it became available; only the writes logged after that
+// point can have changed it.
+struct AvailableValue {
+    Value *Val;
+    Instruction *Def;
+    unsigned Generation;
+
+    AvailableValue() : Val(nullptr), Def(nullptr), Generation(0) {}
+    AvailableValue(Value *Val, Instruction *Def, unsigned Generation)
+        : Val(Val), Def(Def), Generation(Generation) {}
+};
+}
+
+// Memory values are keyed on the address and the loaded or stored type.
+typedef std::pair<Value *, Type *> MemoryKey;
+typedef ScopedHashTable<MemoryKey, AvailableValue, DenseMapInfo<MemoryKey>,
+                        RecyclingAllocator<BumpPtrAllocator,
+                                           ScopedHashTableVal<MemoryKey, AvailableValue>>>
+        MemoryTable;
+
+// Upper bound on the intervening writes checked with alias analysis before
+// a memory value is given up.
+static const unsigned MaxClobberScan = 64;
+
+namespace {
+// Tables shared by the whole dominator-tree walk of one function.
+//
+// Clobbers logs, along the current dom-tree path, every instruction that
+// may write memory. A null entry marks the entry to a block with more than
+// one predecessor, where memory may have been changed on another path.
+//
+// Redundant holds the instructions whose uses were replaced. They stay in
+// place, unused, until the walk ends and removes them all under one lock.
+struct ScopedTables {
+    ExpressionTable Expressions;
+    MemoryTable Memory;
+    SmallVector<Instruction *, 64> Clobbers;
+    SmallVector<Instruction *, 32> Redundant;
+    AAResults &AA;
+    FunctionRun &Run;
+
+    ScopedTables(AAResults &AA, FunctionRun &Run) : AA(AA), Run(Run) {}
+
+    unsigned generation() const { return Clobbers.size(); }
+};
+
+// One entry of the dominator-tree walk. The scopes keep the expressions
+// and memory values of this block visible to every block it dominates and
+// drop them again when the walk leaves the subtree. Generation is the size
+// of the clobber log at the end of the block, which its dom-tree children
+// start from.
+struct DomScope {
+    DomTreeNode *Node;
+    DomTreeNode::const_iterator NextChild;
+    ExpressionTable::ScopeTy ExpressionScope;
+    MemoryTable::ScopeTy MemoryScope;
+    unsigned Generation;
+
+    DomScope(ScopedTables &Tables, DomTreeNode *N)
+        : Node(N), NextChild(N->begin()), ExpressionScope(Tables.Expressions),
+          MemoryScope(Tables.Memory), Generation(0) {}
+};
+}
+
+// Check that none of the writes logged since Prev became available may
+// modify the location read by LI.
+static bool isStillAvailable(const AvailableValue &Prev, LoadInst &LI,
+                             ScopedTables &Tables) {
+    unsigned End = Tables.generation();
+    if (End - Prev.Generation > MaxClobberScan)
+        return false;
+
+    MemoryLocation Loc = MemoryLocation::get(&LI);
+    for (unsigned i = Prev.Generation; i != End; i++) {
+        Instruction *Clobber = Tables.Clobbers[i];
+        if (Clobber == nullptr || isModSet(Tables.AA.getModRefInfo(Clobber, Loc)))
+            return false;
+    }
+    return true;
+}
+
+// Replace a load by the value of an earlier load or store of the same
+// address and type when alias analysis proves that no write in between can
+// have changed it. Returns true if the load was erased.
+static bool eliminateRedundantLoad(LoadInst &LI, ScopedTables &Tables) {
+    if (!LI.isSimple()) {
+        Tables.Clobbers.push_back(&LI);
+        return false;
+    }
+
+    MemoryKey Key(LI.getPointerOperand(), LI.getType());
+    AvailableValue Prev = Tables.Memory.lookup(Key);
+    if (Prev.Val != nullptr && isStillAvailable(Prev, LI, Tables)) {
+        if (isa<StoreInst>(Prev.Def))
+            Tables.Run.Counts.Store2Load++;
+        else
+            Tables.Run.Counts.LdElim++;
+        replaceUses(LI, Prev.Val, Tables.Run);
+        Tables.Redundant.push_back(&LI);
+        return true;
+    }
+
+    Tables.Memory.insert(Key, AvailableValue(&LI, &LI, Tables.generation()));
+    return false;
+}
+
+// A simple store makes its value available to later loads of the same
+// address and type.
+static void recordStore(StoreInst &SI, ScopedTables &Tables) {
+    Tables.Clobbers.push_back(&SI);
+    if (!SI.isSimple())
+        return;
+
+    Value *Val = SI.getValueOperand();
+    MemoryKey Key(SI.getPointerOperand(), Val->getType());
+    Tables.Memory.insert(Key, AvailableValue(Val, &SI, Tables.generation()));
+}
+
+// Value number the instructions of a single block against everything that
+// is available from its dominators.
+static void valueNumberBlock(BasicBlock &BB, ScopedTables &Tables) {
+    // Memory may have changed on another path into a join block.
+    if (BB.getSinglePredecessor() == nullptr)
+        Tables.Clobbers.push_back(nullptr);
+
+    for (auto it = BB.begin(); it != BB.end(); ) {
+        Instruction &I = *it++;
+        if (LoadInst *LI = dyn_cast<LoadInst>(&I)) {
+            eliminateRedundantLoad(*LI, Tables);
+            continue;
+        }
+        if (StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+            recordStore(*SI, Tables);
+            continue;
+        }
+        if (I.mayWriteToMemory())
+            Tables.Clobbers.push_back(&I);
+        if (!canValueNumber(I))
+            continue;
+
+        Expression E = getExpression(I);
+        Instruction *Leader = Tables.Expressions.lookup(E);
+        if (Leader == nullptr) {
+            Tables.Expressions.insert(E, &I);
+            continue;
+        }
+
+        if (Leader->getParent() == &BB)
+            Tables.Run.Counts.Elim++;
+        else
+            Tables.Run.Counts.ElimDom++;
+        replaceUses(I, Leader, Tables.Run);
+        Tables.Redundant.push_back(&I);
+    }
+}
+
+// Hash-based value numbering over the dominator tree: every instruction is
+// looked up once in a scoped table of the expressions computed by its
+// dominators, so the cost is linear in the size of F. The walk uses an
+// explicit stack because dominator trees of large functions can be deep.
+static void eliminateRedundantExpressions(DominatorTree &DT, AAResults &AA,
+                                          FunctionRun &Run) {
+    ScopedTables Tables(AA, Run);
+    SmallVector<std::unique_ptr<DomScope>, 32> Stack;
+
+    Stack.push_back(std::make_unique<DomScope>(Tables, DT.getRootNode()));
+    valueNumberBlock(*DT.getRoot(), Tables);
+    Stack.back()->Generation = Tables.generation();
+    while (!Stack.empty()) {
+        DomScope &Top = *Stack.back();
+        if (Top.NextChild == Top.Node->end()) {
+            Stack.pop_back();
+            continue;
+        }
+        DomTreeNode *Child = *Top.NextChild++;
+        Tables.Clobbers.truncate(Top.Generation);
+        Stack.push_back(std::make_unique<DomScope>(Tables, Child));
+        valueNumberBlock(*Child->getBlock(), Tables);
+        Stack.back()->Generation = Tables.generation();
+    }
+
+    if (Tables.Redundant.empty())
+        return;
+    std::lock_guard<std::mutex> Lock(Run.ContextMutex);
+    for (Instruction *I : Tables.Redundant)
+        removeInstruction(I, Run);
+}
+
+// Upper bound on the instructions scanned for reads between a store and
+// the stores that may overwrite it.
+static const unsigned MaxDeadStoreScan = 256;
+
+// Scan [I, E) for an instruction that may read Loc or leave the function
+// early. Stops at Killer if it is in the range and reports that in Found.
+static bool scanForReads(BasicBlock::iterator I, BasicBlock::iterator E,
+                         const MemoryLocation &Loc, StoreInst *Killer,
+                         AAResults &AA, unsigned &Budget, bool &Found) {
+    Found = false;
+    for (; I != E; ++I) {
+        if (&*I == Killer) {
+            Found = true;
+            return true;
+        }
+        if (Budget-- == 0)
+            return false;
+        if (I->mayThrow() || isRefSet(AA.getModRefInfo(&*I, Loc)))
+            return false;
+    }
+    return true;
+}
+
+// Dead is overwritten by Killer if Killer post-dominates it and no
+// instruction on any path from Dead to Killer may read the location.
+static bool isOverwrittenUnread(StoreInst *Dead, StoreInst *Killer,
+                                AAResults &AA, unsigned &Budget) {
+    MemoryLocation Loc = MemoryLocation::get(Dead);
+    BasicBlock *DeadBB = Dead->getParent();
+    bool Found;
+    if (!scanForReads(std::next(Dead->getIterator()), DeadBB->end(), Loc,
+                      Killer, AA, Budget, Found))
+        return false;
+    if (Found)
+        return true;
+    if (succ_empty(DeadBB))
+        return false;
+
+    SmallVector<BasicBlock *, 16> Worklist(succ_begin(DeadBB), succ_end(DeadBB));
+    SmallPtrSet<BasicBlock *, 16> Visited;
+    while (!Worklist.empty()) {
+        BasicBlock *BB = Worklist.pop_back_val();
+        if (!Visited.insert(BB).second)
+            continue;
+        if (!scanForReads(BB->begin(), BB->end(), Loc, Killer, AA, Budget, Found))
+            return false;
+        if (Found)
+            continue;
+        if (succ_empty(BB))
+            return false;
+        Worklist.append(succ_begin(BB), succ_end(BB));
+    }
+    return true;
+}
+
+static bool postDominates(PostDominatorTree &PDT, Instruction *A, Instruction *B) {
+    if (A->getParent() == B->getParent())
+        return B->comesBefore(A);
+    return PDT.dominates(A->getParent(), B->getParent());
+}
+
+// Upper bound on the later stores to the same address tried as the store
+// that overwrites a given one.
+static const unsigned MaxDeadStoreKillers = 16;
+
+// Remove a store when a later store of the same type to the same address
+// post-dominates it and nothing in between may read the stored location.
+// Dead stores are collected first and erased together, so a store that is
+// itself overwritten can still prove earlier stores dead.
+//
+// Only the stores that follow a store in program order are tried, up to
+// MaxDeadStoreKillers of them, and only the first that post-dominates it:
+// that is the nearest overwrite, and trying every store to the address
+// would be quadratic in their number.
+static void eliminateDeadStores(Function &F, PostDominatorTree &PDT, AAResults &AA,
+                                FunctionRun &Run) {
+    DenseMap<MemoryKey, SmallVector<StoreInst *, 4>> StoresTo;
+    DenseMap<MemoryKey, unsigned> Position;
+    SmallVector<StoreInst *, 32> Stores;
+    for (Instruction &I : instructions(F)) {
+        StoreInst *SI = dyn_cast<StoreInst>(&I);
+        if (SI == nullptr || !SI->isSimple() || !PDT.getNode(SI->getParent()))
+            continue;
+        MemoryKey Key(SI->getPointerOperand(), SI->getValueOperand()->getType());
+        StoresTo[Key].push_back(SI);
+        Stores.push_back(SI);
+    }
+
+    SmallVector<StoreInst *, 32> DeadStores;
+    for (StoreInst *SI : Stores) {
+        MemoryKey Key(SI->getPointerOperand(), SI->getValueOperand()->getType());
+        const SmallVector<StoreInst *, 4> &Later = StoresTo[Key];
+        unsigned Budget = MaxDeadStoreScan;
+        // Stores were listed in program order, so SI is at its position.
+        unsigned I = ++Position[Key];
+        unsigned E = std::min<unsigned>(Later.size(), I + MaxDeadStoreKillers);
+        for (; I < E; ++I) {
+            StoreInst *Killer = Later[I];
+            if (!postDominates(PDT, Killer, SI))
+                continue;
+            if (isOverwrittenUnread(SI, Killer, AA, Budget))
+                DeadStores.push_back(SI);
+            break;
+        }
+    }
+
+    if (DeadStores.empty())
+        return;
+    std::lock_guard<std::mutex> Lock(Run.ContextMutex);
+    for (StoreInst *SI : DeadStores) {
+        removeInstruction(SI, Run);
+        Run.Counts.StElim++;
+    }
+}
+
+// isDead counts an unused alloca as dead, but CSE leaves stack slots to
+// mem2reg: load forwarding and dead store elimination take the loads and
+// stores of a slot, never the slot itself, and the tests expect every
+// alloca to stay.
+static bool isRemovable(Instruction &I) {
+    return isDead(I) && !isa<AllocaInst>(I);
+}
+
+// Use-count driven dead code elimination. The worklist is seeded with the
+// dead instructions in program order; erasing an instruction drops its
+// operand uses, and an operand is queued exactly when its last use goes
+// away, so whole dead chains are removed in one linear, deterministic call.
+// Dropping operands edits the use lists of constants and globals, so the
+// stage runs under one hold of ContextMutex.
+static void removeDeadInstructions(Function &F, FunctionRun &Run) {
+    SmallVector<Instruction *, 64> Worklist;
+    for (Instruction &I : instructions(F))
+        if (isRemovable(I))
+            Worklist.push_back(&I);
+    if (Worklist.empty())
+        return;
+
+    std::lock_guard<std::mutex> Lock(Run.ContextMutex);
+    while (!Worklist.empty()) {
+        Instruction *I = Worklist.pop_back_val();
+        for (Use &U : I->operands()) {
+            Instruction *Op = dyn_cast<Instruction>(U.get());
+            U.set(nullptr);
+            if (Op && isRemovable(*Op))
+                Worklist.push_back(Op);
+        }
+        removeInstruction(I, Run);
+        Run.Counts.Dead++;
+    }
+}
+
+// Fold instructions with InstructionSimplify until nothing changes. The
+// worklist starts with every instruction in program order; when one folds,
+// its users are queued again, so chains of folds finish in a single call.
+// Folding may create constants in the shared context even when it finds
+// no replacement, since the folders build and unique intermediate
+// constants and constant expressions along the way. So the whole stage,
+// not just the RAUW and erase, runs under one hold of ContextMutex, and is
+// serialized across -j workers.
+//
+// The worklist holds plain pointers, not value handles. A removed
+// instruction is only unlinked, and finishRun deletes it after the run, so
+// a queued pointer stays valid; a null parent marks it as removed.
+static void simplifyInstructions(Function &F, const SimplifyQuery &SQ,
+                                 FunctionRun &Run) {
+    SmallVector<Instruction *, 64> Worklist;
+    SmallPtrSet<Instruction *, 32> Queued;
+    for (Instruction &I : instructions(F)) {
+        Worklist.push_back(&I);
+        Queued.insert(&I);
+    }
+    std::reverse(Worklist.begin(), Worklist.end());
+
+    std::lock_guard<std::mutex> Lock(Run.ContextMutex);
+    while (!Worklist.empty()) {
+        Instruction *I = Worklist.pop_back_val();
+        Queued.erase(I);
+        // Skip instructions removed since they were queued.
+        if (I->getParent() == nullptr)
+            continue;
+
+        Value *V = SimplifyInstruction(I, SQ.getWithInstruction(I));
+        if (V == nullptr)
+            continue;
+
+        for (User *U : I->users()) {
+            Instruction *UI = cast<Instruction>(U);
+            if (UI != I && Queued.insert(UI).second)
+                Worklist.push_back(UI);
+        }
+        I->replaceAllUsesWith(V);
+        if (isInstructionTriviallyDead(I, SQ.TLI))
+            removeInstruction(I, Run);
+        Run.Counts.Simplify++;
+    }
+}
+
+// Run the whole pipeline on one function. Simplification runs before value
+// numbering so that CSE sees folded operands, and again afterwards to fold
+// what load forwarding exposed. None of the stages changes the CFG, so the
+// dominator trees stay valid throughout.
+//
+// The assumption cache registers value handles in the shared context, so
+// it is filled and destroyed under ContextMutex.
+//
+// Each stage is charged to Run.Times with the CPU clock of the running
+// thread, and traced as a span nested in the function's span.
+static void optimizeFunction(Function &F, const TargetLibraryInfoImpl &TLII,
+                             FunctionRun &Run) {
+    StringRef Name = F.getName();
+    TimeTraceScope Span("optimizeFunction", Name);
+    const clockid_t Clock = CLOCK_THREAD_CPUTIME_ID;
+    {
+        PhaseTimer Timer(Run.Times.DCE, "DCE", Name, Clock);
+        removeDeadInstructions(F, Run);
+    }
+
+    std::unique_ptr<AssumptionCache> AC(new AssumptionCache(F));
+    {
+        DominatorTree DT;
+        PostDominatorTree PDT;
+        {
+            PhaseTimer Timer(Run.Times.Analysis, "Analysis", Name, Clock);
+            {
+                std::lock_guard<std::mutex> Lock(Run.ContextMutex);
+                (void)AC->assumptions();
+            }
+            DT.recalculate(F);
+            PDT.recalculate(F);
+        }
+        TargetLibraryInfo TLI(TLII);
+        BasicAAResult BasicAA(F.getParent()->getDataLayout(), F, TLI, *AC, &DT);
+        TypeBasedAAResult TBAA;
+        AAResults AA(TLI);
+        AA.addAAResult(BasicAA);
+        AA.addAAResult(TBAA);
+        SimplifyQuery SQ(F.getParent()->getDataLayout(), &TLI, &DT, AC.get());
+
+        {
+            PhaseTimer Timer(Run.Times.Simplify, "Simplify", Name, Clock);
+            simplifyInstructions(F, SQ, Run);
+        }
+        {
+            PhaseTimer Timer(Run.Times.ValueNumbering, "ValueNumbering", Name, Clock);
+            eliminateRedundantExpressions(DT, AA, Run);
+        }
+        {
+            PhaseTimer Timer(Run.Times.DeadStores, "DeadStores", Name, Clock);
+            eliminateDeadStores(F, PDT, AA, Run);
+        }
+        {
+            PhaseTimer Timer(Run.Times.Simplify, "Simplify", Name, Clock);
+            simplifyInstructions(F, SQ, Run);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> Lock(Run.ContextMutex);
+        AC.reset();
+    }
+
+    PhaseTimer Timer(Run.Times.DCE, "DCE", Name, Clock);
+    removeDeadInstructions(F, Run);
+}
+
+// Optimize every function of M, on Jobs worker threads when Jobs > 1. The
+// functions are independent, and each run's deletions and counts are
+// applied in module order afterwards, so the output does not depend on the
+// number of threads.
+static void CommonSubexpressionElimination(Module *M, ModuleStats &Stats, unsigned Jobs) {
+	TargetLibraryInfoImpl TLII(Triple(M->getTargetTriple()));
+	std::vector<Function *> Functions;
 	for (auto func = M->begin(); func!=M->end(); func++) {
-		// looping over functions
-		for (auto basic_block= func->begin(); basic_block!=func->end(); basic_block++) {
-			// looping over basic block 
-			for (auto inst=basic_block->begin(); inst!=basic_block->end(); inst++) {
-				Instruction *my_inst = &(*inst);
-				my_inst->print(errs());
-				errs() << "\n";
-				if (isDead(*inst) == true) {
-				        errs() << "Dead instruction \n" ;
-					dead_inst_list.insert(&*inst);
-				}	       
-			}
-		}
+		if (!func->isDeclaration())
+			Functions.push_back(&*func);
 	}
 
-	// deleting dead instructions 
-	while(dead_inst_list.size()>0) {
-		Instruction* i= *dead_inst_list.begin();
-		dead_inst_list.erase(i);
-		i->eraseFromParent();
-		CSEDead++;
+	std::mutex ContextMutex;
+	std::vector<FunctionRun> Runs;
+	Runs.reserve(Functions.size());
+	for (size_t i = 0; i < Functions.size(); i++)
+		Runs.emplace_back(ContextMutex);
+	if (Jobs == 1) {
+		for (size_t i = 0; i < Functions.size(); i++)
+			optimizeFunction(*Functions[i], TLII, Runs[i]);
+	} else {
+		// The trace profiler is per thread: each task records into its own
+		// and hands it back for timeTraceProfilerWrite when done.
+		bool Trace = timeTraceProfilerEnabled();
+		ThreadPool Pool(hardware_concurrency(Jobs));
+		for (size_t i = 0; i < Functions.size(); i++)
+			Pool.async([&, i] {
+				if (Trace)
+					timeTraceProfilerInitialize(0, "p2");
+				optimizeFunction(*Functions[i], TLII, Runs[i]);
+				if (Trace)
+					timeTraceProfilerFinishThread();
+			});
+		Pool.wait();
 	}
-	errs() << " Printing instructions \n";
-	PrintInstructions(M);
+
+	for (FunctionRun &Run : Runs)
+		finishRun(Run, Stats);
 }
 
 static bool isDead(Instruction &I) {
@@ -259,18 +1155,3 @@ static bool isDead(Instruction &I) {
 
     return false;
 }
-
-static void PrintInstructions(Module *M) {
-
-	for (auto func = M->begin(); func!=M->end(); func++) {
-		// looping over functions
-		for (auto basic_block= func->begin(); basic_block!=func->end(); basic_block++) {
-			// looping over basic block 
-			for (auto inst=basic_block->begin(); inst!=basic_block->end(); inst++) {
-				Instruction *my_inst = &(*inst);
-				my_inst->print(errs());
-				errs() << "\n";
-			}
-		}
-	}
-}
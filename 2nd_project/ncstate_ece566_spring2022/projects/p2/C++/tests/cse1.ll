@@ -11,11 +11,8 @@ define i32 @cse1(i8* %0, i32* %1, i64* %2, i32 %3, i64 %4, i8 %5) {
 ; CHECK-NEXT: alloca
 ; CHECK-NEXT: store
 ; CHECK-NEXT: store
-; CHECK-NEXT: load
-; CHECK-NEXT: load
-; CHECK-NEXT: lshr
-; CHECK-NEXT: store
-; CHECK-NEXT: store
+; CHECK-NEXT: store i32 0
+; CHECK-NEXT: store i32 0
 ; CHECK-NEXT: ret i32
 BB:
   %A = alloca i32, align 4
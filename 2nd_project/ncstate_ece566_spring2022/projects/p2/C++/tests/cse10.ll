@@ -0,0 +1,57 @@
+; ModuleID = 'cse10'
+; CHECK-LABEL: source_filename = "cse10"
+source_filename = "cse10"
+
+; CHECK-LABEL: @cse10(i32* %0, i32* %1, i1 %2)
+define i32 @cse10(i32* %0, i32* %1, i1 %2) {
+; CHECK-NEXT: BB
+; CHECK-NEXT: %L = load i32, i32* %0
+; CHECK-NEXT: br i1
+BB:
+  %L = load i32, i32* %0, align 4
+  br i1 %2, label %BB1, label %BB2
+
+; CHECK-LABEL: BB1:
+; CHECK-NEXT: %3 = bitcast i32* %0 to i8*
+; CHECK-NEXT: %L2 = load i8, i8* %3
+; CHECK-NEXT: %4 = zext i8 %L2 to i32
+; CHECK-NEXT: %5 = add i32 %4, %L
+; CHECK-NEXT: store i32 %5, i32* %1
+; CHECK-NEXT: br label
+BB1:
+  %L1 = load i32, i32* %0, align 4
+  %3 = bitcast i32* %0 to i8*
+  %L2 = load i8, i8* %3, align 1
+  %4 = zext i8 %L2 to i32
+  %5 = add i32 %4, %L1
+  store i32 %5, i32* %1, align 4
+  br label %BB3
+
+; CHECK-LABEL: BB2:
+; CHECK-NEXT: store i32 %L, i32* %1
+; CHECK-NEXT: %L5 = load volatile i32, i32* %0
+; CHECK-NEXT: %L6 = load volatile i32, i32* %0
+; CHECK-NEXT: %6 = add i32 %L5, %L6
+; CHECK-NEXT: store i32 %6, i32* %1
+; CHECK-NEXT: br label
+BB2:
+  %L4 = load i32, i32* %0, align 4
+  store i32 %L4, i32* %1, align 4
+  %L5 = load volatile i32, i32* %0, align 4
+  %L6 = load volatile i32, i32* %0, align 4
+  %6 = add i32 %L5, %L6
+  store i32 %6, i32* %1, align 4
+  br label %BB3
+
+; CHECK-LABEL: BB3:
+; CHECK-NEXT: %L7 = load i32, i32* %0
+; CHECK-NEXT: %7 = add i32 %L7, %L7
+; CHECK-NEXT: %8 = add i32 %7, %L
+; CHECK-NEXT: ret i32 %8
+BB3:
+  %L7 = load i32, i32* %0, align 4
+  %L8 = load i32, i32* %0, align 4
+  %7 = add i32 %L7, %L8
+  %8 = add i32 %7, %L
+  ret i32 %8
+}
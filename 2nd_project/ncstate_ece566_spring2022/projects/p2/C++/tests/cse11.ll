@@ -0,0 +1,44 @@
+; ModuleID = 'cse11'
+; CHECK-LABEL: source_filename = "cse11"
+source_filename = "cse11"
+
+@G = global i32 0, align 4
+@H = global i32 0, align 4
+
+; CHECK-LABEL: @cse11(i32* %0, i32* %1, i32 %2)
+define i32 @cse11(i32* %0, i32* %1, i32 %2) {
+; CHECK-NEXT: BB
+; CHECK-NEXT: %A = alloca i32
+; CHECK-NEXT: store i32 %2, i32* %0
+; CHECK-NEXT: store i32 7, i32* %A
+; CHECK-NEXT: %P1 = getelementptr i32, i32* %0, i64 1
+; CHECK-NEXT: store i32 10, i32* %P1
+; CHECK-NEXT: store i32 8, i32* @G
+; CHECK-NEXT: store i32 9, i32* @H
+; CHECK-NEXT: %X = add i32 %2, 8
+; CHECK-NEXT: br label
+BB:
+  %A = alloca i32, align 4
+  store i32 %2, i32* %0, align 4
+  store i32 7, i32* %A, align 4
+  %P1 = getelementptr i32, i32* %0, i64 1
+  store i32 10, i32* %P1, align 4
+  %L = load i32, i32* %0, align 4
+  store i32 8, i32* @G, align 4
+  store i32 9, i32* @H, align 4
+  %L1 = load i32, i32* @G, align 4
+  %X = add i32 %L, %L1
+  br label %BB1
+
+; CHECK-LABEL: BB1:
+; CHECK-NEXT: store i32 %X, i32* %1
+; CHECK-NEXT: %L2 = load i32, i32* %0
+; CHECK-NEXT: %Y = add i32 %L2, 7
+; CHECK-NEXT: ret i32 %Y
+BB1:
+  store i32 %X, i32* %1, align 4
+  %L2 = load i32, i32* %0, align 4
+  %L3 = load i32, i32* %A, align 4
+  %Y = add i32 %L2, %L3
+  ret i32 %Y
+}
@@ -0,0 +1,45 @@
+; ModuleID = 'cse12'
+; CHECK-LABEL: source_filename = "cse12"
+source_filename = "cse12"
+
+; CHECK-LABEL: @cse12(i32* %0, i32* %1, i32 %2, i1 %3)
+define void @cse12(i32* %0, i32* %1, i32 %2, i1 %3) {
+; CHECK-NEXT: BB
+; CHECK-NEXT: %A = alloca i32
+; CHECK-NEXT: store i32 0, i32* %0
+; CHECK-NEXT: store i32 1, i32* %1
+; CHECK-NEXT: br i1
+BB:
+  %A = alloca i32, align 4
+  store i32 7, i32* %A, align 4
+  store i32 0, i32* %0, align 4
+  store i32 1, i32* %1, align 4
+  br i1 %3, label %BB1, label %BB2
+
+; CHECK-LABEL: BB1:
+; CHECK-NEXT: store i32 %2, i32* %1
+; CHECK-NEXT: br label
+BB1:
+  store i32 %2, i32* %1, align 4
+  br label %BB3
+
+; CHECK-LABEL: BB2:
+; CHECK-NEXT: %L = load i32, i32* %0
+; CHECK-NEXT: %X = add i32 %L, %2
+; CHECK-NEXT: store i32 %X, i32* %1
+; CHECK-NEXT: br label
+BB2:
+  %L = load i32, i32* %0, align 4
+  %X = add i32 %L, %2
+  store i32 %X, i32* %1, align 4
+  br label %BB3
+
+; CHECK-LABEL: BB3:
+; CHECK-NEXT: store i32 %2, i32* %0
+; CHECK-NEXT: store i32 %2, i32* %A
+; CHECK-NEXT: ret void
+BB3:
+  store i32 %2, i32* %0, align 4
+  store i32 %2, i32* %A, align 4
+  ret void
+}
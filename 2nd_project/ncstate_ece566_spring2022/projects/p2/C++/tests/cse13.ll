@@ -0,0 +1,26 @@
+; ModuleID = 'cse13'
+; CHECK-LABEL: source_filename = "cse13"
+source_filename = "cse13"
+
+; CHECK-LABEL: @cse13(i32 %0, i32 %1)
+define i32 @cse13(i32 %0, i32 %1) {
+; CHECK-NEXT: BB
+; CHECK-NEXT: br label
+BB:
+  br label %BB1
+
+; CHECK-LABEL: BB1:
+; CHECK-NEXT: %C = icmp slt i32 %0, %1
+; CHECK-NEXT: br i1 %C
+BB1:
+  %P = phi i32 [ %0, %BB ], [ %S, %BB1 ]
+  %A = and i32 %P, -1
+  %S = shl i32 %A, 0
+  %C = icmp slt i32 %S, %1
+  br i1 %C, label %BB1, label %BB2
+
+; CHECK-LABEL: BB2:
+; CHECK-NEXT: ret i32 %0
+BB2:
+  ret i32 %S
+}
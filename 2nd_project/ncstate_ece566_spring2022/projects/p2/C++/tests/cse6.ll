@@ -9,8 +9,6 @@ define i32 @cse6(i8* %0, i32* %1, i64* %2, i32 %3, i64 %4, i8 %5) {
 ; CHECK-NEXT: alloca
 ; CHECK-NEXT: and
 ; CHECK-NEXT: store
-; CHECK-NEXT: load
-; CHECK-NEXT: store
 ; CHECK-NEXT: icmp sge
 ; CHECK-NEXT: br i1
 ; CHECK-EMPTY:
@@ -44,7 +42,6 @@ BB3:                                              ; preds = %BB
   br label %BB5
 
 ; CHECK-LABEL: BB4:
-; CHECK-NEXT: load
 ; CHECK-NEXT: sdiv
 ; CHECK-NEXT: srem
 ; CHECK-NEXT: store
@@ -71,7 +68,6 @@ BB8:                                              ; preds = %BB9, %BB5
   br i1 %Cmp12, label %BB9, label %BB10
 
 ; CHECK-LABEL: BB9:
-; CHECK-NEXT: load
 ; CHECK-NEXT: store
 ; CHECK-NEXT: br label
 BB9:                                              ; preds = %BB8
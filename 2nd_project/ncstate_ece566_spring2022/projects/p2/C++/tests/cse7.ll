@@ -0,0 +1,32 @@
+; ModuleID = 'cse7'
+; CHECK-LABEL: source_filename = "cse7"
+source_filename = "cse7"
+
+declare void @use(i32)
+declare void @use1(i1)
+
+; CHECK-LABEL: @cse7(i32 %0, i32 %1)
+define void @cse7(i32 %0, i32 %1) {
+; CHECK-NEXT: BB
+; CHECK-NEXT: %A = add i32 %0, %1
+; CHECK-NEXT: call void @use(i32 %A)
+; CHECK-NEXT: call void @use(i32 %A)
+; CHECK-NEXT: %C = add nsw i32 %0, %1
+; CHECK-NEXT: call void @use(i32 %C)
+; CHECK-NEXT: %D = icmp slt i32 %0, %1
+; CHECK-NEXT: call void @use1(i1 %D)
+; CHECK-NEXT: call void @use1(i1 %D)
+; CHECK-NEXT: ret void
+BB:
+  %A = add i32 %0, %1
+  %B = add i32 %1, %0
+  call void @use(i32 %A)
+  call void @use(i32 %B)
+  %C = add nsw i32 %0, %1
+  call void @use(i32 %C)
+  %D = icmp slt i32 %0, %1
+  %E = icmp sgt i32 %1, %0
+  call void @use1(i1 %D)
+  call void @use1(i1 %E)
+  ret void
+}
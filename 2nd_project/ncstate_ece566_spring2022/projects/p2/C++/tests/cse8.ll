@@ -0,0 +1,49 @@
+; ModuleID = 'cse8'
+; CHECK-LABEL: source_filename = "cse8"
+source_filename = "cse8"
+
+declare void @use(i32)
+
+; CHECK-LABEL: @cse8(i32 %0, i32 %1, i1 %2)
+define void @cse8(i32 %0, i32 %1, i1 %2) {
+; CHECK-NEXT: BB
+; CHECK-NEXT: %A = mul i32 %0, %1
+; CHECK-NEXT: call void @use(i32 %A)
+; CHECK-NEXT: br i1
+BB:
+  %A = mul i32 %0, %1
+  call void @use(i32 %A)
+  br i1 %2, label %BB1, label %BB2
+
+; CHECK-LABEL: BB1:
+; CHECK-NEXT: call void @use(i32 %A)
+; CHECK-NEXT: %C = sub i32 %0, %1
+; CHECK-NEXT: call void @use(i32 %C)
+; CHECK-NEXT: br label
+BB1:
+  %B = mul i32 %1, %0
+  call void @use(i32 %B)
+  %C = sub i32 %0, %1
+  call void @use(i32 %C)
+  br label %BB3
+
+; CHECK-LABEL: BB2:
+; CHECK-NEXT: call void @use(i32 %A)
+; CHECK-NEXT: br label
+BB2:
+  %D = mul i32 %0, %1
+  call void @use(i32 %D)
+  br label %BB3
+
+; CHECK-LABEL: BB3:
+; CHECK-NEXT: call void @use(i32 %A)
+; CHECK-NEXT: %F = sub i32 %0, %1
+; CHECK-NEXT: call void @use(i32 %F)
+; CHECK-NEXT: ret void
+BB3:
+  %E = mul i32 %0, %1
+  call void @use(i32 %E)
+  %F = sub i32 %0, %1
+  call void @use(i32 %F)
+  ret void
+}
@@ -0,0 +1,24 @@
+; ModuleID = 'cse9'
+; CHECK-LABEL: source_filename = "cse9"
+source_filename = "cse9"
+
+; CHECK-LABEL: @cse9(i32* %0, i32 %1, i32 %2)
+define i32 @cse9(i32* %0, i32 %1, i32 %2) {
+; CHECK-NEXT: BB
+; CHECK-NEXT: %K = add i32 %1, 1
+; CHECK-NEXT: br label
+BB:
+  %A = add i32 %1, %2
+  %L = load i32, i32* %0, align 4
+  %B = mul i32 %A, %L
+  %C = xor i32 %B, %A
+  %K = add i32 %1, 1
+  br label %BB1
+
+; CHECK-LABEL: BB1:
+; CHECK-NEXT: ret i32 %K
+BB1:
+  %D = icmp eq i32 %C, %B
+  %E = select i1 %D, i32 %C, i32 %A
+  ret i32 %K
+}
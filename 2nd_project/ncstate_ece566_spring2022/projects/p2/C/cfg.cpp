@@ -94,6 +94,23 @@ unsigned LLVMCountPredecessors(LLVMBasicBlockRef BB)
   
   return count;
 }
+
+unsigned LLVMCountSuccessors(LLVMBasicBlockRef BB)
+{
+  return succ_size(unwrap(BB));
+}
+
+void LLVMGetSuccessors(LLVMBasicBlockRef BB, LLVMBasicBlockRef *Succs)
+{
+  for (BasicBlock *Succ : successors(unwrap(BB)))
+    *Succs++ = wrap(Succ);
+}
+
+void LLVMGetPredecessors(LLVMBasicBlockRef BB, LLVMBasicBlockRef *Preds)
+{
+  for (BasicBlock *Pred : predecessors(unwrap(BB)))
+    *Preds++ = wrap(Pred);
+}
   
 LLVMValueRef LLVMCloneInstruction(LLVMValueRef Insn)
 {
@@ -102,6 +119,12 @@ LLVMValueRef LLVMCloneInstruction(LLVMValueRef Insn)
   return wrap(clone);
 }
 
+void LLVMMoveInstructionBefore(LLVMValueRef Insn, LLVMValueRef Before)
+{
+  Instruction *insn = (Instruction*)unwrap(Insn);
+  insn->moveBefore((Instruction*)unwrap(Before));
+}
+
 LLVMValueRef LLVMFirstInstructionAfterPHI(LLVMBasicBlockRef BB)
 {
   LLVMValueRef insn = LLVMGetFirstInstruction(BB);
@@ -26,7 +26,20 @@ LLVMBasicBlockRef LLVMGetNextPredecessor(LLVMBasicBlockRef BB, LLVMBasicBlockRef
 
 unsigned LLVMCountPredecessors(LLVMBasicBlockRef BB);
 
+/* LLVMGetNextSuccessor and LLVMGetNextPredecessor search for their
+   argument, so walking all N neighbours with them is O(N^2). These fill
+   Succs with LLVMCountSuccessors(BB), and Preds with
+   LLVMCountPredecessors(BB), blocks in O(N). */
+unsigned LLVMCountSuccessors(LLVMBasicBlockRef BB);
+void LLVMGetSuccessors(LLVMBasicBlockRef BB, LLVMBasicBlockRef *Succs);
+void LLVMGetPredecessors(LLVMBasicBlockRef BB, LLVMBasicBlockRef *Preds);
+
 LLVMValueRef LLVMCloneInstruction(LLVMValueRef Insn);
+
+/* Move Insn, keeping its name, to just before Before, in the same block
+   or another, in O(1). Removing it and inserting it with a builder
+   renames it. */
+void LLVMMoveInstructionBefore(LLVMValueRef Insn, LLVMValueRef Before);
 LLVMValueRef LLVMFirstInstructionAfterPHI(LLVMBasicBlockRef);
 
 #ifdef __cplusplus
@@ -24,17 +24,40 @@ LLVMStatisticsRef CSESimplify;
 LLVMStatisticsRef CSELdElim;
 LLVMStatisticsRef CSEStore2Load;
 LLVMStatisticsRef CSEStElim;
+LLVMHistogramRef CSEInstsPerFunction;
 
 void CommonSubexpressionElimination(LLVMModuleRef Module)
 {
+    LLVMValueRef F;
     CSEDead = LLVMStatisticsCreate("CSEDead", "CSE found dead instructions");
     CSEElim = LLVMStatisticsCreate("CSEElim", "CSE redundant instructions");
     CSESimplify = LLVMStatisticsCreate("CSESimplify", "CSE simplified instructions");
     CSELdElim = LLVMStatisticsCreate("CSELdElim", "CSE redundant loads");
     CSEStore2Load = LLVMStatisticsCreate("CSEStore2Load", "CSE forwarded store to load");
     CSEStElim = LLVMStatisticsCreate("CSEStElim", "CSE redundant stores");
+    CSEInstsPerFunction = LLVMHistogramCreate("CSEInstsPerFunction", "CSE instructions per function, before CSE");
 
-    /* Implement here! */
+    for (F = LLVMGetFirstFunction(Module); F != NULL; F = LLVMGetNextFunction(F)) {
+        size_t len;
+        uint64_t insts = 0;
+        LLVMBasicBlockRef BB;
+        if (LLVMCountBasicBlocks(F) == 0)
+            continue;
+
+        for (BB = LLVMGetFirstBasicBlock(F); BB != NULL; BB = LLVMGetNextBasicBlock(BB)) {
+            LLVMValueRef I;
+            for (I = LLVMGetFirstInstruction(BB); I != NULL; I = LLVMGetNextInstruction(I))
+                insts++;
+        }
+        LLVMHistogramAdd(CSEInstsPerFunction, insts);
+
+        /* Per-function span in the -trace output. */
+        LLVMTimeTraceBegin("optimizeFunction", LLVMGetValueName2(F, &len));
+
+        /* Implement here! */
+
+        LLVMTimeTraceEnd();
+    }
 
     LLVMStatisticsInc(CSEDead);
 }
@@ -7,6 +7,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <memory>
+#include <vector>
 
 /* LLVM Header Files */
 #include "llvm-c/Core.h"
@@ -16,90 +18,301 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/GlobalVariable.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/CFG.h"
 //#include "llvm/PassManager.h"
 #include "llvm/IR/Dominators.h"
-//#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/PostDominators.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/Type.h"
 
 #include "dominance.h"
+#include "worklist.h"
 
 using namespace llvm;
 
-Function *Current=NULL;
-DominatorTreeBase<BasicBlock,false> *DT=NULL;
-DominatorTreeBase<BasicBlock,true> *PDT=NULL;
-
-LoopInfoBase<BasicBlock,Loop> *LI=NULL;
-
-void UpdateDominators(Function *F)
+typedef DenseMap<BasicBlock*, SmallVector<BasicBlock*,4>> FrontierMap;
+
+// Cooper, Harvey and Kennedy: a join block B is in the frontier of every
+// block on the tree path from each of its CFG predecessors up to, but not
+// including, the immediate dominator of B. On the post-dominator tree the
+// same walk over successors gives the post-dominance frontiers. Each block
+// is added to a frontier once, so the cost is linear in the size of the
+// frontiers.
+template <bool IsPostDom>
+static void computeFrontiers(Function &F, DominatorTreeBase<BasicBlock,IsPostDom> &Tree,
+			     FrontierMap &Frontiers)
 {
-  if (Current != F)
+  Frontiers.clear();
+  for (BasicBlock &B : F)
     {
-      Current = F;
+      DomTreeNodeBase<BasicBlock> *Node = Tree.getNode(&B);
+      if (Node == NULL)
+	continue;
+
+      SmallVector<BasicBlock*,8> Preds;
+      if (IsPostDom)
+	Preds.append(succ_begin(&B), succ_end(&B));
+      else
+	Preds.append(pred_begin(&B), pred_end(&B));
+      if (Preds.size() < 2)
+	continue;
+
+      for (BasicBlock *P : Preds)
+	for (DomTreeNodeBase<BasicBlock> *Runner = Tree.getNode(P);
+	     Runner != NULL && Runner != Node->getIDom() && Runner->getBlock() != NULL;
+	     Runner = Runner->getIDom())
+	  {
+	    SmallVector<BasicBlock*,4> &Frontier = Frontiers[Runner->getBlock()];
+	    if (Frontier.empty() || Frontier.back() != &B)
+	      Frontier.push_back(&B);
+	  }
+    }
+}
 
-      if (DT==NULL)
+// Cytron et al.: the iterated frontier of Defs is the closure of the
+// frontier map over Defs. Every block is expanded at most once.
+static worklist_t iteratedFrontier(const FrontierMap &Frontiers, ArrayRef<BasicBlock*> Defs)
+{
+  worklist_t Result = worklist_create();
+  SmallPtrSet<BasicBlock*,32> InResult;
+  SmallPtrSet<BasicBlock*,32> Queued(Defs.begin(), Defs.end());
+  SmallVector<BasicBlock*,32> Work(Defs.begin(), Defs.end());
+
+  while (!Work.empty())
+    {
+      BasicBlock *X = Work.pop_back_val();
+      auto it = Frontiers.find(X);
+      if (it == Frontiers.end())
+	continue;
+      for (BasicBlock *Y : it->second)
 	{
-	  DT = new DominatorTreeBase<BasicBlock,false>();
-	  PDT = new DominatorTreeBase<BasicBlock,true>();
-	  if (LI==NULL)
-	    LI = new LoopInfoBase<BasicBlock,Loop>();
+	  if (!InResult.insert(Y).second)
+	    continue;
+	  worklist_insert(Result, LLVMBasicBlockAsValue(wrap(Y)));
+	  if (Queued.insert(Y).second)
+	    Work.push_back(Y);
 	}
-      
-      DT->recalculate(*F);
-      PDT->recalculate(*F);
+    }
+  return Result;
+}
+
+namespace {
+// The analyses of one function. Each is built on the first query that
+// needs it, so a pass that only asks about dominators never pays for
+// post-dominators or loops.
+//
+// CFG edge changes are queued in Pending and applied to a tree in one
+// batch the next time it is queried, in the way of DomTreeUpdater's lazy
+// strategy. AppliedDT and AppliedPDT count the updates a tree has seen.
+// LoopInfo and the frontiers have no incremental update and are rebuilt
+// instead.
+struct FunctionAnalyses {
+  Function *F;
+  bool ValidDT, ValidPDT, ValidLI, ValidDF, ValidPDF;
+  DominatorTree DT;
+  PostDominatorTree PDT;
+  LoopInfoBase<BasicBlock,Loop> LI;
+  FrontierMap DF, PDF;
+  std::vector<DominatorTree::UpdateType> Pending;
+  size_t AppliedDT, AppliedPDT;
+
+  FunctionAnalyses(Function *F)
+    : F(F), ValidDT(false), ValidPDT(false), ValidLI(false),
+      ValidDF(false), ValidPDF(false), AppliedDT(0), AppliedPDT(0) {}
+
+  DominatorTree &getDT()
+  {
+    if (!ValidDT)
+      {
+	DT.recalculate(*F);
+	ValidDT = true;
+      }
+    else if (AppliedDT < Pending.size())
+      DT.applyUpdates(makeArrayRef(Pending).drop_front(AppliedDT));
+    AppliedDT = Pending.size();
+    trimPending();
+    return DT;
+  }
+
+  PostDominatorTree &getPDT()
+  {
+    if (!ValidPDT)
+      {
+	PDT.recalculate(*F);
+	ValidPDT = true;
+      }
+    else if (AppliedPDT < Pending.size())
+      PDT.applyUpdates(makeArrayRef(Pending).drop_front(AppliedPDT));
+    AppliedPDT = Pending.size();
+    trimPending();
+    return PDT;
+  }
+
+  // Forget the updates that every valid tree has applied.
+  void trimPending()
+  {
+    if ((ValidDT && AppliedDT < Pending.size()) ||
+	(ValidPDT && AppliedPDT < Pending.size()))
+      return;
+    Pending.clear();
+    AppliedDT = AppliedPDT = 0;
+  }
+
+  void recordUpdate(DominatorTree::UpdateKind Kind, BasicBlock *From, BasicBlock *To)
+  {
+    ValidLI = ValidDF = ValidPDF = false;
+    if (ValidDT || ValidPDT)
+      Pending.push_back({Kind, From, To});
+  }
+
+  LoopInfoBase<BasicBlock,Loop> &getLI()
+  {
+    if (!ValidLI)
+      {
+	LI.releaseMemory();
+	LI.analyze(getDT());
+	ValidLI = true;
+      }
+    return LI;
+  }
+
+  FrontierMap &getDF()
+  {
+    if (!ValidDF)
+      {
+	computeFrontiers(*F, getDT(), DF);
+	ValidDF = true;
+      }
+    return DF;
+  }
+
+  FrontierMap &getPDF()
+  {
+    if (!ValidPDF)
+      {
+	computeFrontiers(*F, getPDT(), PDF);
+	ValidPDF = true;
+      }
+    return PDF;
+  }
+
+  void invalidate()
+  {
+    ValidDT = ValidPDT = ValidLI = ValidDF = ValidPDF = false;
+    Pending.clear();
+    AppliedDT = AppliedPDT = 0;
+  }
+};
+}
+
+// Analyses of every function queried so far. They stay valid until the
+// CFG of the function changes, so queries that alternate between functions
+// do not recompute them; LLVMInvalidateDominators marks them stale.
+static DenseMap<Function*, std::unique_ptr<FunctionAnalyses>> Analyses;
+
+static FunctionAnalyses &getAnalyses(Function *F)
+{
+  std::unique_ptr<FunctionAnalyses> &A = Analyses[F];
+  if (A == NULL)
+    A.reset(new FunctionAnalyses(F));
+  return *A;
+}
 
-      LI->analyze(*DT);
+DominatorTree &LLVMGetSharedDominatorTree(Function *F)
+{
+  return getAnalyses(F).getDT();
+}
+
+void LLVMInvalidateDominators(LLVMValueRef Fun)
+{
+  if (Fun == NULL)
+    {
+      Analyses.clear();
+      return;
     }
+
+  auto it = Analyses.find((Function*)unwrap(Fun));
+  if (it != Analyses.end())
+    it->second->invalidate();
+}
+
+void LLVMDominatorsInsertEdge(LLVMBasicBlockRef From, LLVMBasicBlockRef To)
+{
+  auto it = Analyses.find(unwrap(From)->getParent());
+  if (it != Analyses.end())
+    it->second->recordUpdate(DominatorTree::Insert, unwrap(From), unwrap(To));
+}
+
+void LLVMDominatorsDeleteEdge(LLVMBasicBlockRef From, LLVMBasicBlockRef To)
+{
+  auto it = Analyses.find(unwrap(From)->getParent());
+  if (it != Analyses.end())
+    it->second->recordUpdate(DominatorTree::Delete, unwrap(From), unwrap(To));
+}
+
+LLVMBool LLVMVerifyDominators(LLVMValueRef Fun)
+{
+  bool Broken = false;
+  for (auto &A : Analyses)
+    {
+      if (Fun != NULL && A.first != unwrap(Fun))
+	continue;
+      if (A.second->ValidDT)
+	Broken |= !A.second->getDT().verify(DominatorTree::VerificationLevel::Fast);
+      if (A.second->ValidPDT)
+	Broken |= !A.second->getPDT().verify(PostDominatorTree::VerificationLevel::Fast);
+    }
+  return Broken;
 }
 
 // Test if a dom b
 LLVMBool LLVMDominates(LLVMValueRef Fun, LLVMBasicBlockRef a, LLVMBasicBlockRef b)
 {
-  UpdateDominators((Function*)unwrap(Fun));
-  return DT->dominates(unwrap(a),unwrap(b));
+  return getAnalyses((Function*)unwrap(Fun)).getDT().dominates(unwrap(a),unwrap(b));
 }
 
 // Test if a pdom b
 LLVMBool LLVMPostDominates(LLVMValueRef Fun, LLVMBasicBlockRef a, LLVMBasicBlockRef b)
 {
-  UpdateDominators((Function*)unwrap(Fun));
-  return PDT->dominates(unwrap(a),unwrap(b));
+  return getAnalyses((Function*)unwrap(Fun)).getPDT().dominates(unwrap(a),unwrap(b));
 }
 
 LLVMBool LLVMIsReachableFromEntry(LLVMValueRef Fun, LLVMBasicBlockRef bb) {
-  UpdateDominators((Function*)unwrap(Fun));
-  return DT->isReachableFromEntry(unwrap(bb));
+  return getAnalyses((Function*)unwrap(Fun)).getDT().isReachableFromEntry(unwrap(bb));
 }
 
 
 LLVMBasicBlockRef LLVMImmDom(LLVMBasicBlockRef BB)
 {
-  UpdateDominators(unwrap(BB)->getParent());
+  DominatorTree &DT = getAnalyses(unwrap(BB)->getParent()).getDT();
 
-  if ( DT->getNode((BasicBlock*)unwrap(BB)) == NULL )
+  if ( DT.getNode((BasicBlock*)unwrap(BB)) == NULL )
     return NULL;
   
-  if ( DT->getNode((BasicBlock*)unwrap(BB))->getIDom()==NULL )
+  if ( DT.getNode((BasicBlock*)unwrap(BB))->getIDom()==NULL )
     return NULL;
 
-  return wrap(DT->getNode(unwrap(BB))->getIDom()->getBlock());
+  return wrap(DT.getNode(unwrap(BB))->getIDom()->getBlock());
 }
 
 LLVMBasicBlockRef LLVMImmPostDom(LLVMBasicBlockRef BB)
 {
-  UpdateDominators(unwrap(BB)->getParent());
+  PostDominatorTree &PDT = getAnalyses(unwrap(BB)->getParent()).getPDT();
 
-  if (PDT->getNode(unwrap(BB))->getIDom()==NULL)
+  if (PDT.getNode(unwrap(BB))->getIDom()==NULL)
     return NULL;
 
-  return wrap((BasicBlock*)PDT->getNode(unwrap(BB))->getIDom()->getBlock());
+  return wrap((BasicBlock*)PDT.getNode(unwrap(BB))->getIDom()->getBlock());
 }
 
 LLVMBasicBlockRef LLVMFirstDomChild(LLVMBasicBlockRef BB)
 {
-  UpdateDominators(unwrap(BB)->getParent());
-  DomTreeNodeBase<BasicBlock> *Node = DT->getNode(unwrap(BB));
+  DominatorTree &DT = getAnalyses(unwrap(BB)->getParent()).getDT();
+  DomTreeNodeBase<BasicBlock> *Node = DT.getNode(unwrap(BB));
 
   if(Node==NULL)
     return NULL;
@@ -112,52 +325,101 @@ LLVMBasicBlockRef LLVMFirstDomChild(LLVMBasicBlockRef BB)
 
 LLVMBasicBlockRef LLVMNextDomChild(LLVMBasicBlockRef BB, LLVMBasicBlockRef Child)
 {
-  UpdateDominators(unwrap(BB)->getParent());
-  DomTreeNodeBase<BasicBlock> *Node = DT->getNode(unwrap(BB));
+  DominatorTree &DT = getAnalyses(unwrap(BB)->getParent()).getDT();
+  DomTreeNodeBase<BasicBlock> *Node = DT.getNode(unwrap(BB));
   DomTreeNodeBase<BasicBlock>::iterator it,end;
 
   bool next=false;
   for(it=Node->begin(),end=Node->end(); it!=end; it++)
     if (next)
       return wrap((*it)->getBlock());
-    else if (*it==DT->getNode(unwrap(Child)))
+    else if (*it==DT.getNode(unwrap(Child)))
       next=true;
 
   return NULL;
 }
 
+unsigned LLVMCountDomChildren(LLVMBasicBlockRef BB)
+{
+  DominatorTree &DT = getAnalyses(unwrap(BB)->getParent()).getDT();
+  DomTreeNodeBase<BasicBlock> *Node = DT.getNode(unwrap(BB));
+
+  if(Node==NULL)
+    return 0;
+  return Node->getNumChildren();
+}
+
+void LLVMGetDomChildren(LLVMBasicBlockRef BB, LLVMBasicBlockRef *Children)
+{
+  DominatorTree &DT = getAnalyses(unwrap(BB)->getParent()).getDT();
+  DomTreeNodeBase<BasicBlock> *Node = DT.getNode(unwrap(BB));
+
+  if(Node==NULL)
+    return;
+  for (DomTreeNodeBase<BasicBlock> *Child : Node->children())
+    *Children++ = wrap(Child->getBlock());
+}
+
 
 LLVMBasicBlockRef LLVMNearestCommonDominator(LLVMBasicBlockRef A, LLVMBasicBlockRef B)
 {
-  UpdateDominators(unwrap(A)->getParent());
-  return wrap(DT->findNearestCommonDominator(unwrap(A),unwrap(B)));
+  return wrap(getAnalyses(unwrap(A)->getParent()).getDT().findNearestCommonDominator(unwrap(A),unwrap(B)));
 }
 
 unsigned LLVMGetLoopNestingDepth(LLVMBasicBlockRef BB)
 {
-  if (LI==NULL)
-    UpdateDominators(unwrap(BB)->getParent());
+  return getAnalyses(unwrap(BB)->getParent()).getLI().getLoopDepth(unwrap(BB));
+}
+
+
+static worklist_t frontierOf(const FrontierMap &Frontiers, BasicBlock *BB)
+{
+  worklist_t Result = worklist_create();
+  auto it = Frontiers.find(BB);
+  if (it != Frontiers.end())
+    for (BasicBlock *Y : it->second)
+      worklist_insert(Result, LLVMBasicBlockAsValue(wrap(Y)));
+  return Result;
+}
+
+worklist_t LLVMDominanceFrontierLocal(LLVMBasicBlockRef BB)
+{
+  return frontierOf(getAnalyses(unwrap(BB)->getParent()).getDF(), unwrap(BB));
+}
 
-  return LI->getLoopDepth(unwrap(BB));
+worklist_t LLVMDominanceFrontierClosure(LLVMBasicBlockRef BB)
+{
+  BasicBlock *B = unwrap(BB);
+  return iteratedFrontier(getAnalyses(B->getParent()).getDF(), B);
 }
 
+worklist_t LLVMPostDominanceFrontierLocal(LLVMBasicBlockRef BB)
+{
+  return frontierOf(getAnalyses(unwrap(BB)->getParent()).getPDF(), unwrap(BB));
+}
 
-LLVMBasicBlockRef LLVMDominanceFrontierLocal(LLVMBasicBlockRef BB)
+worklist_t LLVMPostDominanceFrontierClosure(LLVMBasicBlockRef BB)
 {
-  return NULL;
+  BasicBlock *B = unwrap(BB);
+  return iteratedFrontier(getAnalyses(B->getParent()).getPDF(), B);
 }
 
-LLVMBasicBlockRef LLVMDominanceFrontierClosure(LLVMBasicBlockRef BB)
+static SmallVector<BasicBlock*,16> unwrapBlocks(LLVMBasicBlockRef *Blocks, unsigned Count)
 {
-  return NULL;
+  SmallVector<BasicBlock*,16> Defs;
+  for (unsigned i = 0; i < Count; i++)
+    Defs.push_back(unwrap(Blocks[i]));
+  return Defs;
 }
 
-LLVMBasicBlockRef LLVMPostDominanceFrontierLocal(LLVMBasicBlockRef BB)
+worklist_t LLVMIteratedDominanceFrontier(LLVMValueRef Fun, LLVMBasicBlockRef *Blocks, unsigned Count)
 {
-  return NULL;
+  FunctionAnalyses &A = getAnalyses((Function*)unwrap(Fun));
+  return iteratedFrontier(A.getDF(), unwrapBlocks(Blocks, Count));
 }
 
-LLVMBasicBlockRef LLVMPostDominanceFrontierClosure(LLVMBasicBlockRef BB)
+worklist_t LLVMIteratedPostDominanceFrontier(LLVMValueRef Fun, LLVMBasicBlockRef *Blocks, unsigned Count)
 {
-  return NULL;
+  FunctionAnalyses &A = getAnalyses((Function*)unwrap(Fun));
+  return iteratedFrontier(A.getPDF(), unwrapBlocks(Blocks, Count));
 }
@@ -6,6 +6,8 @@
 #include "llvm-c/DataTypes.h"
 #include "llvm-c/ExternC.h"
 
+#include "worklist.h"
+
 LLVM_C_EXTERN_C_BEGIN
 
 LLVMBool LLVMDominates(LLVMValueRef Fun, LLVMBasicBlockRef a, LLVMBasicBlockRef b);
@@ -19,8 +21,54 @@ unsigned LLVMGetLoopNestingDepth(LLVMBasicBlockRef BB);
 
 LLVMBasicBlockRef LLVMFirstDomChild(LLVMBasicBlockRef BB);
 LLVMBasicBlockRef LLVMNextDomChild(LLVMBasicBlockRef BB, LLVMBasicBlockRef Child);
+
+/* LLVMNextDomChild searches for Child, so walking all N children with it
+   is O(N^2). This fills Children with LLVMCountDomChildren(BB) blocks in
+   O(N). */
+unsigned LLVMCountDomChildren(LLVMBasicBlockRef BB);
+void LLVMGetDomChildren(LLVMBasicBlockRef BB, LLVMBasicBlockRef *Children);
 LLVMBool LLVMIsReachableFromEntry(LLVMValueRef Fun, LLVMBasicBlockRef bb);
 
+/* Dominance frontiers, as worklists of block values for the caller to
+   worklist_destroy. Local is DF(BB) and Closure the iterated DF+(BB). */
+worklist_t LLVMDominanceFrontierLocal(LLVMBasicBlockRef BB);
+worklist_t LLVMDominanceFrontierClosure(LLVMBasicBlockRef BB);
+worklist_t LLVMPostDominanceFrontierLocal(LLVMBasicBlockRef BB);
+worklist_t LLVMPostDominanceFrontierClosure(LLVMBasicBlockRef BB);
+
+/* Iterated (post-)dominance frontier of Count blocks of Fun, e.g. the
+   blocks that define a variable, where SSA construction places phis. */
+worklist_t LLVMIteratedDominanceFrontier(LLVMValueRef Fun, LLVMBasicBlockRef *Blocks, unsigned Count);
+worklist_t LLVMIteratedPostDominanceFrontier(LLVMValueRef Fun, LLVMBasicBlockRef *Blocks, unsigned Count);
+
+/* The analyses behind these queries are cached per function and built on
+   first use. Call this after changing the CFG of Fun, or before deleting
+   it, to mark them stale; NULL drops the analyses of every function. */
+void LLVMInvalidateDominators(LLVMValueRef Fun);
+
+/* Record a change to the CFG instead of invalidating: an edge From->To
+   that was added or removed. Make the change first, then record it; the
+   trees are updated incrementally at the next query. Splitting the edge
+   A->B with a new block N records Insert(A,N), Insert(N,B), Delete(A,B). */
+void LLVMDominatorsInsertEdge(LLVMBasicBlockRef From, LLVMBasicBlockRef To);
+void LLVMDominatorsDeleteEdge(LLVMBasicBlockRef From, LLVMBasicBlockRef To);
+
+/* Check the cached trees of Fun, or of every function for NULL, against
+   trees built afresh, printing any difference to stderr. Like
+   LLVMVerifyModule, returns true if they disagree. */
+LLVMBool LLVMVerifyDominators(LLVMValueRef Fun);
+
 LLVM_C_EXTERN_C_END
 
+#ifdef __cplusplus
+namespace llvm {
+class DominatorTree;
+class Function;
+}
+
+/* The cached dominator tree of F, for the C++ side of the C interface
+   (e.g. loop.cpp) to share instead of building its own. */
+llvm::DominatorTree &LLVMGetSharedDominatorTree(llvm::Function *F);
+#endif
+
 #endif
@@ -0,0 +1,350 @@
+/*
+ * File: gcm.c
+ *
+ * Description:
+ *   Global code motion (Click, PLDI'95) on top of the C dominance
+ *   interface, placing code by block frequency.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* LLVM Header Files */
+#include "llvm-c/Core.h"
+
+/* Header file global to this project */
+#include "cfg.h"
+#include "dominance.h"
+#include "gcm.h"
+#include "profile.h"
+#include "stats.h"
+#include "numbering.h"
+
+LLVMStatisticsRef GCMHoisted;
+LLVMStatisticsRef GCMSunk;
+
+/* Instructions that compute a value from their operands alone and cannot
+   trap, so that they may run in any block their operands dominate. The
+   rest stay where they are. */
+static int is_floating(LLVMValueRef I)
+{
+    switch (LLVMGetInstructionOpcode(I)) {
+    case LLVMFNeg:
+    case LLVMAdd: case LLVMFAdd: case LLVMSub: case LLVMFSub:
+    case LLVMMul: case LLVMFMul: case LLVMFDiv: case LLVMFRem:
+    case LLVMShl: case LLVMLShr: case LLVMAShr:
+    case LLVMAnd: case LLVMOr: case LLVMXor:
+    case LLVMTrunc: case LLVMZExt: case LLVMSExt:
+    case LLVMFPToUI: case LLVMFPToSI: case LLVMUIToFP: case LLVMSIToFP:
+    case LLVMFPTrunc: case LLVMFPExt: case LLVMPtrToInt: case LLVMIntToPtr:
+    case LLVMBitCast: case LLVMAddrSpaceCast:
+    case LLVMICmp: case LLVMFCmp: case LLVMSelect:
+    case LLVMGetElementPtr:
+    case LLVMExtractValue: case LLVMInsertValue:
+    case LLVMExtractElement: case LLVMInsertElement: case LLVMShuffleVector:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+typedef struct {
+    LLVMValueRef F;
+    LLVMBasicBlockRef entry;
+    LLVMNumberingRef N;
+    sidetable_t early;   /* instruction number -> earliest block, if floating */
+    sidetable_t placed;  /* non-NULL for floating instructions scheduled late */
+    sidetable_t done;    /* non-NULL for instructions order_block has moved */
+    worklist_t moved;  /* blocks code moved into */
+} GCM;
+
+/* Slot of instruction I in a side table; GCM only moves instructions, so
+   the numbering of the function stays good throughout. */
+static void **slot(GCM *g, sidetable_t table, LLVMValueRef I)
+{
+    return &table[LLVMGetInstructionNumber(g->N, I)];
+}
+
+static int floats(GCM *g, LLVMValueRef I)
+{
+    return LLVMIsAInstruction(I) && is_floating(I)
+        && LLVMIsReachableFromEntry(g->F, LLVMGetInstructionParent(I));
+}
+
+/* The deeper of two blocks on one dominator-tree path. */
+static LLVMBasicBlockRef deeper(GCM *g, LLVMBasicBlockRef a, LLVMBasicBlockRef b)
+{
+    return LLVMDominates(g->F, a, b) ? b : a;
+}
+
+/* A pending instruction of the early or late walk, with how far through
+   its operands or uses the walk has got. Both walks keep these on an
+   explicit stack, since def-use chains can be far deeper than the C
+   stack. */
+typedef struct {
+    LLVMValueRef I;
+    int next;                  /* early: the next operand */
+    LLVMUseRef use;            /* late: the next use */
+    LLVMBasicBlockRef best;    /* early: the deepest operand block so far */
+} Frame;
+
+typedef struct {
+    Frame *frames;
+    unsigned depth, capacity;
+} Stack;
+
+static Frame *push(Stack *st, LLVMValueRef I)
+{
+    Frame *f;
+    if (st->depth == st->capacity) {
+        st->capacity = st->capacity ? st->capacity * 2 : 64;
+        st->frames = realloc(st->frames, sizeof(Frame) * st->capacity);
+    }
+    f = &st->frames[st->depth++];
+    memset(f, 0, sizeof(*f));
+    f->I = I;
+    return f;
+}
+
+/* The earliest block I may go in: the deepest block of its operands, once
+   each floating operand is itself placed as early as it may go. */
+static LLVMBasicBlockRef schedule_early(GCM *g, LLVMValueRef I)
+{
+    Stack st = { NULL, 0, 0 };
+    LLVMBasicBlockRef best;
+
+    if (!floats(g, I))
+        return LLVMGetInstructionParent(I);
+    if (*slot(g, g->early, I) != NULL)
+        return *slot(g, g->early, I);
+
+    push(&st, I)->best = g->entry;
+    for (;;) {
+        Frame *f = &st.frames[st.depth - 1];
+        if (f->next < LLVMGetNumOperands(f->I)) {
+            LLVMValueRef op = LLVMGetOperand(f->I, f->next++);
+            if (!LLVMIsAInstruction(op))
+                continue;
+            if (!floats(g, op))
+                f->best = deeper(g, f->best, LLVMGetInstructionParent(op));
+            else if (*slot(g, g->early, op) != NULL)
+                f->best = deeper(g, f->best, *slot(g, g->early, op));
+            else
+                push(&st, op)->best = g->entry;
+            continue;
+        }
+
+        best = f->best;
+        *slot(g, g->early, f->I) = best;
+        if (--st.depth == 0)
+            break;
+        f = &st.frames[st.depth - 1];
+        f->best = deeper(g, f->best, best);
+    }
+
+    free(st.frames);
+    return best;
+}
+
+/* Extend lca (NULL at first) by the block a use of I by user U needs I
+   in: the incoming block for a phi, U's own block otherwise. Uses in
+   unreachable code need nothing. */
+static LLVMBasicBlockRef use_block(GCM *g, LLVMValueRef U, LLVMValueRef I,
+                                   LLVMBasicBlockRef lca)
+{
+    unsigned i;
+    LLVMBasicBlockRef bb;
+
+    if (!LLVMIsAPHINode(U)) {
+        bb = LLVMGetInstructionParent(U);
+        if (!LLVMIsReachableFromEntry(g->F, bb))
+            return lca;
+        return lca ? LLVMNearestCommonDominator(lca, bb) : bb;
+    }
+
+    for (i = 0; i < LLVMCountIncoming(U); i++) {
+        if (LLVMGetIncomingValue(U, i) != I)
+            continue;
+        bb = LLVMGetIncomingBlock(U, i);
+        if (!LLVMIsReachableFromEntry(g->F, bb))
+            continue;
+        lca = lca ? LLVMNearestCommonDominator(lca, bb) : bb;
+    }
+    return lca;
+}
+
+/* Move I into bb, before its terminator. Code that moved in may now come
+   before what it uses; order_block puts such blocks right once everything
+   is placed, rather than searching bb for a spot on every move. */
+static void place(GCM *g, LLVMValueRef I, LLVMBasicBlockRef bb)
+{
+    if (LLVMGetInstructionParent(I) == bb)
+        return;
+    LLVMMoveInstructionBefore(I, LLVMGetBasicBlockTerminator(bb));
+    worklist_insert(g->moved, LLVMBasicBlockAsValue(bb));
+}
+
+/* Move I to the least frequent block between the latest one its uses
+   allow and the earliest one its operands allow; its users are placed
+   already. */
+static void place_late(GCM *g, LLVMValueRef I)
+{
+    LLVMBasicBlockRef early, lca = NULL, best, bb, old;
+    uint64_t best_freq;
+    LLVMUseRef use;
+
+    for (use = LLVMGetFirstUse(I); use != NULL; use = LLVMGetNextUse(use))
+        lca = use_block(g, LLVMGetUser(use), I, lca);
+    if (lca == NULL)
+        return;
+
+    /* Walk up from the latest legal block to the earliest and keep the
+       least frequent, preferring the later of equally frequent blocks. */
+    early = schedule_early(g, I);
+    best = lca;
+    best_freq = LLVMGetBlockFrequency(best);
+    for (bb = lca; bb != early; ) {
+        bb = LLVMImmDom(bb);
+        if (LLVMGetBlockFrequency(bb) < best_freq) {
+            best = bb;
+            best_freq = LLVMGetBlockFrequency(bb);
+        }
+    }
+
+    old = LLVMGetInstructionParent(I);
+    place(g, I, best);
+    if (best != old) {
+        if (LLVMDominates(g->F, best, old))
+            LLVMStatisticsInc(GCMHoisted);
+        else
+            LLVMStatisticsInc(GCMSunk);
+    }
+}
+
+/* Place every floating user of I first, so that the uses are where they
+   will stay, and then I. */
+static void schedule_late(GCM *g, LLVMValueRef I)
+{
+    Stack st = { NULL, 0, 0 };
+
+    if (*slot(g, g->placed, I) != NULL)
+        return;
+    *slot(g, g->placed, I) = I;
+
+    push(&st, I)->use = LLVMGetFirstUse(I);
+    while (st.depth > 0) {
+        Frame *f = &st.frames[st.depth - 1];
+        if (f->use != NULL) {
+            LLVMValueRef U = LLVMGetUser(f->use);
+            f->use = LLVMGetNextUse(f->use);
+            if (floats(g, U) && *slot(g, g->placed, U) == NULL) {
+                *slot(g, g->placed, U) = U;
+                push(&st, U)->use = LLVMGetFirstUse(U);
+            }
+            continue;
+        }
+        place_late(g, f->I);
+        st.depth--;
+    }
+
+    free(st.frames);
+}
+
+/* Put bb back in def-before-use order: walk its instructions in their
+   current order and move each in front of the terminator, moving any
+   operand from bb that has not been moved yet in front of it first. Each
+   instruction moves once, so this is linear in the block. */
+static void order_block(GCM *g, LLVMBasicBlockRef bb)
+{
+    LLVMValueRef term = LLVMGetBasicBlockTerminator(bb);
+    LLVMValueRef I, *insts;
+    Stack st = { NULL, 0, 0 };
+    unsigned i, n = 0;
+
+    for (I = LLVMFirstInstructionAfterPHI(bb); I != term; I = LLVMGetNextInstruction(I))
+        n++;
+    insts = malloc(sizeof(LLVMValueRef) * (n + 1));
+    n = 0;
+    for (I = LLVMFirstInstructionAfterPHI(bb); I != term; I = LLVMGetNextInstruction(I))
+        insts[n++] = I;
+
+    for (i = 0; i < n; i++) {
+        if (*slot(g, g->done, insts[i]) != NULL)
+            continue;
+        push(&st, insts[i]);
+        *slot(g, g->done, insts[i]) = insts[i];
+        while (st.depth > 0) {
+            Frame *f = &st.frames[st.depth - 1];
+            if (f->next < LLVMGetNumOperands(f->I)) {
+                LLVMValueRef op = LLVMGetOperand(f->I, f->next++);
+                if (LLVMIsAInstruction(op) && !LLVMIsAPHINode(op)
+                    && LLVMGetInstructionParent(op) == bb && *slot(g, g->done, op) == NULL) {
+                    *slot(g, g->done, op) = op;
+                    push(&st, op);
+                }
+                continue;
+            }
+            LLVMMoveInstructionBefore(f->I, term);
+            st.depth--;
+        }
+    }
+
+    free(st.frames);
+    free(insts);
+}
+
+static void gcm_function(GCM *g)
+{
+    LLVMBasicBlockRef bb;
+    LLVMValueRef I;
+    unsigned n;
+    worklist_t all = worklist_create();
+
+    g->entry = LLVMGetEntryBasicBlock(g->F);
+    g->N = LLVMNumberFunction(g->F);
+    n = LLVMNumberingInstructionCount(g->N);
+    g->early = sidetable_create(n);
+    g->placed = sidetable_create(n);
+    g->done = sidetable_create(n);
+    g->moved = worklist_create();
+
+    /* Early positions first, from the code as it stands; then the late
+       pass moves instructions, so collect them before it starts. */
+    for (bb = LLVMGetFirstBasicBlock(g->F); bb != NULL; bb = LLVMGetNextBasicBlock(bb))
+        for (I = LLVMGetFirstInstruction(bb); I != NULL; I = LLVMGetNextInstruction(I))
+            if (floats(g, I)) {
+                schedule_early(g, I);
+                worklist_insert(all, I);
+            }
+
+    while (!worklist_empty(all))
+        schedule_late(g, worklist_pop(all));
+    while (!worklist_empty(g->moved))
+        order_block(g, LLVMValueAsBasicBlock(worklist_pop(g->moved)));
+
+    worklist_destroy(all);
+    worklist_destroy(g->moved);
+    sidetable_destroy(g->done);
+    sidetable_destroy(g->placed);
+    sidetable_destroy(g->early);
+    /* The numbers still name the instructions, but no longer give their
+       order. */
+    LLVMInvalidateNumbering(g->F);
+}
+
+void GlobalCodeMotion(LLVMModuleRef Module)
+{
+    GCM g;
+    GCMHoisted = LLVMStatisticsCreate("GCMHoisted", "GCM instructions moved to a dominator");
+    GCMSunk = LLVMStatisticsCreate("GCMSunk", "GCM instructions moved to a less frequent block");
+
+    for (g.F = LLVMGetFirstFunction(Module); g.F != NULL; g.F = LLVMGetNextFunction(g.F)) {
+        size_t len;
+        if (LLVMCountBasicBlocks(g.F) == 0)
+            continue;
+
+        LLVMTimeTraceBegin("GCM", LLVMGetValueName2(g.F, &len));
+        gcm_function(&g);
+        LLVMTimeTraceEnd();
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef GCM_H
+#define GCM_H
+
+#include "llvm/Support/DataTypes.h"
+#include "llvm-c/Core.h"
+
+#ifdef __cplusplus
+
+/* Need these includes to support the LLVM 'cast' template for the C++ 'wrap' 
+   and 'unwrap' conversion functions. */
+#include "llvm/IR/Module.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/IR/IRBuilder.h"
+
+extern "C" {
+#endif
+
+/* Click-style global code motion of the pure computations of each
+   function: schedule each as early as its operands allow, then as late as
+   its uses allow, and place it in the least frequently run block on the
+   dominator-tree path between the two (see LLVMGetBlockFrequency). */
+void GlobalCodeMotion(LLVMModuleRef Module);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,389 @@
+/*
+ * File: ivsr.c
+ *
+ * Description:
+ *   Induction-variable strength reduction and widening on top of the C
+ *   loop interface.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* LLVM Header Files */
+#include "llvm-c/Core.h"
+
+/* Header file global to this project */
+#include "cfg.h"
+#include "ivsr.h"
+#include "loop.h"
+#include "numbering.h"
+#include "transform.h"
+#include "valmap.h"
+#include "stats.h"
+
+LLVMStatisticsRef IVSRRewritten;
+LLVMStatisticsRef IVSRWidened;
+LLVMStatisticsRef IVSRNoLatch;
+
+/* A loop with a preheader and a single latch; the header's two
+   predecessors are one of each. */
+typedef struct {
+    LLVMLoopRef L;
+    LLVMBasicBlockRef preheader, header, latch;
+    LLVMBuilderRef Builder;
+    valmap_t base;          /* derived value -> its first value, in the preheader */
+    valmap_t candidates;    /* instructions to rewrite, or already rewritten */
+} IVLoop;
+
+static int invariant(IVLoop *s, LLVMValueRef V)
+{
+    return LLVMIsValueLoopInvariant(s->L, V);
+}
+
+/* The increment of a basic induction variable, a header phi stepped by
+   next = phi + inc, inc + phi or phi - inc on the latch; NULL if V is
+   not one. */
+static LLVMValueRef basic_iv(IVLoop *s, LLVMValueRef V, LLVMValueRef *inc)
+{
+    LLVMValueRef next;
+    LLVMOpcode op;
+
+    if (!LLVMIsAPHINode(V) || LLVMGetInstructionParent(V) != s->header
+        || LLVMGetTypeKind(LLVMTypeOf(V)) != LLVMIntegerTypeKind)
+        return NULL;
+    next = LLVMGetIncomingBlock(V, 0) == s->latch ? LLVMGetIncomingValue(V, 0)
+                                                  : LLVMGetIncomingValue(V, 1);
+    if (!LLVMIsAInstruction(next))
+        return NULL;
+    op = LLVMGetInstructionOpcode(next);
+    if ((op == LLVMAdd || op == LLVMSub) && LLVMGetOperand(next, 0) == V
+        && invariant(s, LLVMGetOperand(next, 1))) {
+        *inc = LLVMGetOperand(next, 1);
+        return next;
+    }
+    if (op == LLVMAdd && LLVMGetOperand(next, 1) == V
+        && invariant(s, LLVMGetOperand(next, 0))) {
+        *inc = LLVMGetOperand(next, 0);
+        return next;
+    }
+    return NULL;
+}
+
+static int affine(IVLoop *s, LLVMValueRef V, int *nsw);
+
+/* The induction-variable and invariant operands of a binary operator;
+   false unless it has one of each. */
+static int split(IVLoop *s, LLVMValueRef V, LLVMValueRef *iv, LLVMValueRef *inv,
+                 int *iv_first, int *nsw)
+{
+    LLVMValueRef a = LLVMGetOperand(V, 0), b = LLVMGetOperand(V, 1);
+
+    if (invariant(s, b) && affine(s, a, nsw)) {
+        *iv = a, *inv = b, *iv_first = 1;
+        return 1;
+    }
+    if (invariant(s, a) && affine(s, b, nsw)) {
+        *iv = b, *inv = a, *iv_first = 0;
+        return 1;
+    }
+    return 0;
+}
+
+/* True if V is an affine function of a basic induction variable of the
+   loop, built from add, sub, mul and shl by invariants and from sext.
+   nsw is set if no step of it may wrap, which a sext needs of its
+   operand for the widened variable to count the same values. */
+static int affine(IVLoop *s, LLVMValueRef V, int *nsw)
+{
+    LLVMValueRef iv, inv, next;
+    int iv_first;
+
+    if ((next = basic_iv(s, V, &inv)) != NULL) {
+        *nsw = LLVMHasNoSignedWrap(next);
+        return 1;
+    }
+    if (!LLVMIsAInstruction(V) || !LLVMLoopContainsInst(s->L, V))
+        return 0;
+
+    switch (LLVMGetInstructionOpcode(V)) {
+    case LLVMAdd:
+    case LLVMMul:
+    case LLVMShl:
+        if (!split(s, V, &iv, &inv, &iv_first, nsw))
+            return 0;
+        if (LLVMGetInstructionOpcode(V) == LLVMShl && !iv_first)
+            return 0;
+        *nsw = *nsw && LLVMHasNoSignedWrap(V);
+        return 1;
+    case LLVMSub:
+        if (!split(s, V, &iv, &inv, &iv_first, nsw))
+            return 0;
+        *nsw = *nsw && LLVMHasNoSignedWrap(V);
+        return 1;
+    case LLVMSExt:
+        return affine(s, LLVMGetOperand(V, 0), nsw) && *nsw;
+    default:
+        return 0;
+    }
+}
+
+/* The value of an affine V on the first trip, computed in the
+   preheader. */
+static LLVMValueRef emit_base(IVLoop *s, LLVMValueRef V)
+{
+    LLVMValueRef iv, inv, r, b;
+    int iv_first, nsw;
+
+    if (valmap_check(s->base, V))
+        return valmap_find(s->base, V);
+
+    if (LLVMIsAPHINode(V)) {
+        r = LLVMGetIncomingBlock(V, 0) == s->preheader ? LLVMGetIncomingValue(V, 0)
+                                                       : LLVMGetIncomingValue(V, 1);
+    } else if (LLVMGetInstructionOpcode(V) == LLVMSExt) {
+        r = LLVMBuildSExt(s->Builder, emit_base(s, LLVMGetOperand(V, 0)), LLVMTypeOf(V), "");
+    } else {
+        split(s, V, &iv, &inv, &iv_first, &nsw);
+        b = emit_base(s, iv);
+        switch (LLVMGetInstructionOpcode(V)) {
+        case LLVMAdd:
+            r = LLVMBuildAdd(s->Builder, b, inv, "");
+            break;
+        case LLVMSub:
+            r = iv_first ? LLVMBuildSub(s->Builder, b, inv, "")
+                         : LLVMBuildSub(s->Builder, inv, b, "");
+            break;
+        case LLVMMul:
+            r = LLVMBuildMul(s->Builder, b, inv, "");
+            break;
+        default:
+            r = LLVMBuildShl(s->Builder, b, inv, "");
+            break;
+        }
+    }
+
+    valmap_insert(s->base, V, r);
+    return r;
+}
+
+/* What an affine V adds on each trip, computed in the preheader in the
+   type Ty of the value being rewritten. Below a sext the step is taken
+   in the wide type, so that it cannot wrap where the values do not. */
+static LLVMValueRef emit_step(IVLoop *s, LLVMValueRef V, LLVMTypeRef Ty)
+{
+    LLVMValueRef iv, inv, next, r;
+    int iv_first, nsw;
+
+    if ((next = basic_iv(s, V, &inv)) != NULL) {
+        r = LLVMBuildSExtOrBitCast(s->Builder, inv, Ty, "");
+        return LLVMGetInstructionOpcode(next) == LLVMSub ? LLVMBuildNeg(s->Builder, r, "") : r;
+    }
+    if (LLVMGetInstructionOpcode(V) == LLVMSExt)
+        return emit_step(s, LLVMGetOperand(V, 0), Ty);
+
+    split(s, V, &iv, &inv, &iv_first, &nsw);
+    r = emit_step(s, iv, Ty);
+    switch (LLVMGetInstructionOpcode(V)) {
+    case LLVMAdd:
+        return r;
+    case LLVMSub:
+        return iv_first ? r : LLVMBuildNeg(s->Builder, r, "");
+    case LLVMMul:
+        return LLVMBuildMul(s->Builder, r, LLVMBuildSExtOrBitCast(s->Builder, inv, Ty, ""), "");
+    default:
+        return LLVMBuildShl(s->Builder, r, LLVMBuildZExtOrBitCast(s->Builder, inv, Ty, ""), "");
+    }
+}
+
+/* Erase V if it is arithmetic of the loop that nothing uses any more, and
+   then its operands likewise. Candidates are left to the main loop. */
+static void delete_dead(IVLoop *s, LLVMValueRef V)
+{
+    LLVMValueRef ops[2];
+    unsigned i, n;
+
+    if (!LLVMIsAInstruction(V) || LLVMGetFirstUse(V) != NULL
+        || valmap_check(s->candidates, V) || !LLVMLoopContainsInst(s->L, V))
+        return;
+    switch (LLVMGetInstructionOpcode(V)) {
+    case LLVMAdd:
+    case LLVMSub:
+    case LLVMMul:
+    case LLVMShl:
+    case LLVMSExt:
+        break;
+    default:
+        return;
+    }
+
+    n = LLVMGetNumOperands(V);
+    for (i = 0; i < n; i++)
+        ops[i] = LLVMGetOperand(V, i);
+    LLVMInstructionEraseFromParent(V);
+    for (i = 0; i < n; i++)
+        delete_dead(s, ops[i]);
+}
+
+/* Replace C by a new header phi that starts at C's first value and adds
+   C's step on the latch. */
+static void rewrite(IVLoop *s, LLVMValueRef C)
+{
+    LLVMValueRef base, step, phi, next, op;
+    LLVMValueRef values[2];
+    LLVMBasicBlockRef blocks[2];
+    LLVMTypeRef Ty = LLVMTypeOf(C);
+    char *name;
+    size_t len;
+
+    LLVMPositionBuilderBefore(s->Builder, LLVMGetBasicBlockTerminator(s->preheader));
+    base = emit_base(s, C);
+    step = emit_step(s, C, Ty);
+
+    LLVMPositionBuilderBefore(s->Builder, LLVMGetFirstInstruction(s->header));
+    phi = LLVMBuildPhi(s->Builder, Ty, "");
+    LLVMPositionBuilderBefore(s->Builder, LLVMGetBasicBlockTerminator(s->latch));
+    next = LLVMBuildAdd(s->Builder, phi, step, "");
+
+    values[0] = base, blocks[0] = s->preheader;
+    values[1] = next, blocks[1] = s->latch;
+    LLVMAddIncoming(phi, values, blocks, 2);
+
+    /* The phi takes over C's name once C is gone. */
+    name = strdup(LLVMGetValueName2(C, &len));
+    op = LLVMGetOperand(C, 0);
+    LLVMReplaceAllUsesWith(C, phi);
+    LLVMInstructionEraseFromParent(C);
+    LLVMSetValueName2(phi, name, len);
+    free(name);
+    delete_dead(s, op);
+}
+
+static int is_candidate(IVLoop *s, LLVMValueRef I)
+{
+    int nsw;
+
+    switch (LLVMGetInstructionOpcode(I)) {
+    case LLVMMul:
+    case LLVMShl:
+    case LLVMSExt:
+        return affine(s, I, &nsw);
+    default:
+        return 0;
+    }
+}
+
+/* The single predecessor of the header inside the loop, or NULL. */
+static LLVMBasicBlockRef single_latch(LLVMLoopRef L, LLVMBasicBlockRef header)
+{
+    LLVMBasicBlockRef preds[2];
+
+    if (LLVMCountPredecessors(header) != 2)
+        return NULL;
+    LLVMGetPredecessors(header, preds);
+    if (LLVMLoopContainsBasicBlock(L, preds[0]) == LLVMLoopContainsBasicBlock(L, preds[1]))
+        return NULL;
+    return LLVMLoopContainsBasicBlock(L, preds[0]) ? preds[0] : preds[1];
+}
+
+static int reduce_loop(LLVMValueRef F, LLVMLoopRef L, LLVMBuilderRef Builder)
+{
+    IVLoop s;
+    LLVMBasicBlockRef bb;
+    LLVMValueRef I, *found = NULL;
+    unsigned count = 0, capacity = 0;
+    int changed = 0;
+
+    s.L = L;
+    s.Builder = Builder;
+    s.preheader = LLVMGetPreheader(L);
+    if (s.preheader == NULL || !LLVMSingleSuccessor(s.preheader)) {
+        LLVMStatisticsInc(IVSRNoLatch);
+        return 0;
+    }
+    s.header = LLVMGetFirstSuccessor(s.preheader);
+    s.latch = single_latch(L, s.header);
+    if (s.latch == NULL) {
+        LLVMStatisticsInc(IVSRNoLatch);
+        return 0;
+    }
+    s.base = valmap_create();
+    s.candidates = valmap_create();
+
+    /* Find every candidate before rewriting any, since a rewrite adds
+       phis to the header that would otherwise pass for basic ones. */
+    for (bb = LLVMGetFirstBasicBlock(F); bb != NULL; bb = LLVMGetNextBasicBlock(bb)) {
+        if (!LLVMLoopContainsBasicBlock(L, bb))
+            continue;
+        for (I = LLVMGetFirstInstruction(bb); I != NULL; I = LLVMGetNextInstruction(I)) {
+            if (!is_candidate(&s, I))
+                continue;
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 8;
+                found = realloc(found, sizeof(LLVMValueRef) * capacity);
+            }
+            found[count++] = I;
+            valmap_insert(s.candidates, I, NULL);
+        }
+    }
+
+    /* Users first, so that a sext of a mul gets one wide variable and the
+       mul, left without uses, none. */
+    while (count > 0) {
+        I = found[--count];
+        if (LLVMGetFirstUse(I) == NULL) {
+            LLVMValueRef op = LLVMGetOperand(I, 0);
+            LLVMInstructionEraseFromParent(I);
+            delete_dead(&s, op);
+            continue;
+        }
+        if (LLVMGetInstructionOpcode(I) == LLVMSExt)
+            LLVMStatisticsInc(IVSRWidened);
+        LLVMStatisticsInc(IVSRRewritten);
+        rewrite(&s, I);
+        changed = 1;
+    }
+
+    free(found);
+    valmap_destroy(s.base);
+    valmap_destroy(s.candidates);
+    return changed;
+}
+
+void InductionVariableStrengthReduction(LLVMModuleRef Module)
+{
+    LLVMValueRef F;
+    LLVMBuilderRef Builder = LLVMCreateBuilderInContext(LLVMGetModuleContext(Module));
+    IVSRRewritten = LLVMStatisticsCreate("IVSRRewritten", "IVSR induction variables rewritten");
+    IVSRWidened = LLVMStatisticsCreate("IVSRWidened", "IVSR induction variables widened");
+    IVSRNoLatch = LLVMStatisticsCreate("IVSRNoLatch", "IVSR loops without a preheader or single latch");
+
+    for (F = LLVMGetFirstFunction(Module); F != NULL; F = LLVMGetNextFunction(F)) {
+        size_t len;
+        LLVMLoopInfoRef LI;
+        LLVMLoopRef *Loops;
+        unsigned i, n;
+        int changed = 0;
+
+        if (LLVMCountBasicBlocks(F) == 0)
+            continue;
+
+        LLVMTimeTraceBegin("IVSR", LLVMGetValueName2(F, &len));
+
+        /* New phis and increments go into existing blocks, so the loops
+           stay valid from one loop to the next. */
+        LI = LLVMCreateLoopInfoRef(F);
+        n = LLVMCountAllLoops(LI);
+        Loops = malloc(sizeof(LLVMLoopRef) * (n + 1));
+        LLVMGetLoopsInnermostFirst(LI, Loops);
+        for (i = 0; i < n; i++)
+            changed |= reduce_loop(F, Loops[i], Builder);
+        free(Loops);
+        LLVMDisposeLoopInfoRef(LI);
+        if (changed)
+            LLVMInvalidateNumbering(F);
+
+        LLVMTimeTraceEnd();
+    }
+
+    LLVMDisposeBuilder(Builder);
+}
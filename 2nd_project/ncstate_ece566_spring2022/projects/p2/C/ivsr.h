@@ -0,0 +1,27 @@
+#ifndef IVSR_H
+#define IVSR_H
+
+#include "llvm/Support/DataTypes.h"
+#include "llvm-c/Core.h"
+
+#ifdef __cplusplus
+
+/* Need these includes to support the LLVM 'cast' template for the C++ 'wrap' 
+   and 'unwrap' conversion functions. */
+#include "llvm/IR/Module.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/IR/IRBuilder.h"
+
+extern "C" {
+#endif
+
+/* Replace multiplies, shifts and sign extensions of induction variables
+   with new induction variables that add a step each trip, widening 32-bit
+   array indices to 64 bits along the way. */
+void InductionVariableStrengthReduction(LLVMModuleRef Module);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
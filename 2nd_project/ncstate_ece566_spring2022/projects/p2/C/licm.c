@@ -0,0 +1,220 @@
+/*
+ * File: licm.c
+ *
+ * Description:
+ *   Loop-invariant code motion on top of the C loop interface.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* LLVM Header Files */
+#include "llvm-c/Core.h"
+
+/* Header file global to this project */
+#include "dominance.h"
+#include "licm.h"
+#include "loop.h"
+#include "numbering.h"
+#include "worklist.h"
+#include "stats.h"
+
+LLVMStatisticsRef LICMBasic;
+LLVMStatisticsRef LICMLoadHoist;
+LLVMStatisticsRef LICMNoPreheader;
+
+/* The object an address points into: the address with any GEPs and
+   bitcasts stripped. */
+static LLVMValueRef underlying_object(LLVMValueRef addr)
+{
+    for (;;) {
+        LLVMOpcode op;
+        if (LLVMIsAInstruction(addr))
+            op = LLVMGetInstructionOpcode(addr);
+        else if (LLVMIsAConstantExpr(addr))
+            op = LLVMGetConstOpcode(addr);
+        else
+            return addr;
+        if (op != LLVMGetElementPtr && op != LLVMBitCast)
+            return addr;
+        addr = LLVMGetOperand(addr, 0);
+    }
+}
+
+static int is_identified_object(LLVMValueRef obj)
+{
+    return LLVMIsAAllocaInst(obj) || LLVMIsAGlobalVariable(obj);
+}
+
+/* What the loop may write: the objects of its stores, or anything at all
+   if it stores through an unknown pointer, calls or has atomics. */
+typedef struct {
+    LLVMValueRef *objects;
+    unsigned count;
+    int unknown;
+} LoopWrites;
+
+static void collect_writes(LLVMValueRef F, LLVMLoopRef L, LoopWrites *w)
+{
+    LLVMBasicBlockRef bb;
+    LLVMValueRef I;
+    unsigned capacity = 0;
+
+    memset(w, 0, sizeof(*w));
+    for (bb = LLVMGetFirstBasicBlock(F); bb != NULL; bb = LLVMGetNextBasicBlock(bb)) {
+        if (!LLVMLoopContainsBasicBlock(L, bb))
+            continue;
+        for (I = LLVMGetFirstInstruction(bb); I != NULL; I = LLVMGetNextInstruction(I)) {
+            switch (LLVMGetInstructionOpcode(I)) {
+            case LLVMStore: {
+                LLVMValueRef obj = underlying_object(LLVMGetOperand(I, 1));
+                if (!is_identified_object(obj)) {
+                    w->unknown = 1;
+                    break;
+                }
+                if (w->count == capacity) {
+                    capacity = capacity ? capacity * 2 : 8;
+                    w->objects = realloc(w->objects, sizeof(LLVMValueRef) * capacity);
+                }
+                w->objects[w->count++] = obj;
+                break;
+            }
+            case LLVMCall:
+            case LLVMInvoke:
+            case LLVMAtomicRMW:
+            case LLVMAtomicCmpXchg:
+            case LLVMFence:
+                w->unknown = 1;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+static int may_write(LoopWrites *w, LLVMValueRef obj)
+{
+    unsigned i;
+    if (w->unknown || !is_identified_object(obj))
+        return 1;
+    for (i = 0; i < w->count; i++)
+        if (w->objects[i] == obj)
+            return 1;
+    return 0;
+}
+
+/* True if bb runs on every trip through the loop that leaves it, so that
+   a load from it may be executed in the preheader instead. A loop that
+   never exits gives no such guarantee. */
+static int dominates_exits(LLVMValueRef F, LLVMLoopRef L, LLVMBasicBlockRef bb)
+{
+    worklist_t exits = LLVMGetExitBlocks(L);
+    int all = !worklist_empty(exits);
+    while (!worklist_empty(exits)) {
+        LLVMBasicBlockRef exit = LLVMValueAsBasicBlock(worklist_pop(exits));
+        if (!LLVMDominates(F, bb, exit))
+            all = 0;
+    }
+    worklist_destroy(exits);
+    return all;
+}
+
+static int hoist_load(LLVMValueRef F, LLVMLoopRef L, LoopWrites *w,
+                      LLVMBuilderRef Builder, LLVMValueRef I)
+{
+    LLVMValueRef addr = LLVMGetOperand(I, 0);
+    char *name;
+    size_t len;
+
+    if (LLVMGetVolatile(I) || LLVMGetOrdering(I) > LLVMAtomicOrderingUnordered
+        || may_write(w, underlying_object(addr)))
+        return 0;
+    if (LLVMIsAInstruction(addr))
+        LLVMMakeLoopInvariant(L, addr);
+    if (!LLVMIsValueLoopInvariant(L, addr))
+        return 0;
+    /* A load straight from an alloca or global cannot fault; any other
+       address is only known to be valid where the loop dereferences it. */
+    if (!is_identified_object(addr)
+        && !dominates_exits(F, L, LLVMGetInstructionParent(I)))
+        return 0;
+
+    /* The builder renames what it inserts, so keep the load's name. */
+    name = strdup(LLVMGetValueName2(I, &len));
+    LLVMPositionBuilderBefore(Builder, LLVMGetBasicBlockTerminator(LLVMGetPreheader(L)));
+    LLVMInstructionRemoveFromParent(I);
+    LLVMInsertIntoBuilderWithName(Builder, I, name);
+    free(name);
+    return 1;
+}
+
+static void hoist_loop(LLVMValueRef F, LLVMLoopRef L, LLVMBuilderRef Builder)
+{
+    LLVMBasicBlockRef bb;
+    LLVMValueRef I, next;
+    LoopWrites writes;
+
+    if (LLVMGetPreheader(L) == NULL) {
+        LLVMStatisticsInc(LICMNoPreheader);
+        return;
+    }
+
+    collect_writes(F, L, &writes);
+
+    /* Blocks in layout order, so that most operands are seen, and hoisted,
+       before their uses; LLVMMakeLoopInvariant hoists the rest. */
+    for (bb = LLVMGetFirstBasicBlock(F); bb != NULL; bb = LLVMGetNextBasicBlock(bb)) {
+        if (!LLVMLoopContainsBasicBlock(L, bb))
+            continue;
+        for (I = LLVMGetFirstInstruction(bb); I != NULL; I = next) {
+            next = LLVMGetNextInstruction(I);
+            if (LLVMIsALoadInst(I)) {
+                if (hoist_load(F, L, &writes, Builder, I))
+                    LLVMStatisticsInc(LICMLoadHoist);
+            } else if (LLVMMakeLoopInvariant(L, I)) {
+                LLVMStatisticsInc(LICMBasic);
+            }
+        }
+    }
+
+    free(writes.objects);
+}
+
+void LoopInvariantCodeMotion(LLVMModuleRef Module)
+{
+    LLVMValueRef F;
+    LLVMBuilderRef Builder = LLVMCreateBuilderInContext(LLVMGetModuleContext(Module));
+    LICMBasic = LLVMStatisticsCreate("LICMBasic", "LICM hoisted instructions");
+    LICMLoadHoist = LLVMStatisticsCreate("LICMLoadHoist", "LICM hoisted loads");
+    LICMNoPreheader = LLVMStatisticsCreate("LICMNoPreheader", "LICM loops without a preheader");
+
+    for (F = LLVMGetFirstFunction(Module); F != NULL; F = LLVMGetNextFunction(F)) {
+        size_t len;
+        LLVMLoopInfoRef LI;
+        LLVMLoopRef *Loops;
+        unsigned i, n;
+
+        if (LLVMCountBasicBlocks(F) == 0)
+            continue;
+
+        LLVMTimeTraceBegin("LICM", LLVMGetValueName2(F, &len));
+
+        /* Hoisting moves instructions between blocks but leaves the CFG,
+           and so the dominator tree and loops, as they are. */
+        LI = LLVMCreateLoopInfoRef(F);
+        n = LLVMCountAllLoops(LI);
+        Loops = malloc(sizeof(LLVMLoopRef) * (n + 1));
+        LLVMGetLoopsInnermostFirst(LI, Loops);
+        for (i = 0; i < n; i++)
+            hoist_loop(F, Loops[i], Builder);
+        free(Loops);
+        LLVMDisposeLoopInfoRef(LI);
+        /* The numbering, though, also stands for program order */
+        LLVMInvalidateNumbering(F);
+
+        LLVMTimeTraceEnd();
+    }
+
+    LLVMDisposeBuilder(Builder);
+}
@@ -0,0 +1,26 @@
+#ifndef LICM_H
+#define LICM_H
+
+#include "llvm/Support/DataTypes.h"
+#include "llvm-c/Core.h"
+
+#ifdef __cplusplus
+
+/* Need these includes to support the LLVM 'cast' template for the C++ 'wrap' 
+   and 'unwrap' conversion functions. */
+#include "llvm/IR/Module.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/IR/IRBuilder.h"
+
+extern "C" {
+#endif
+
+/* Hoist loop-invariant computations, and loads from memory the loop does
+   not write, into the preheader of each loop, innermost loops first. */
+void LoopInvariantCodeMotion(LLVMModuleRef Module);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
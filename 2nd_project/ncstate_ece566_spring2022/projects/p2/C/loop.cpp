@@ -22,7 +22,9 @@
 //#include "llvm/Analysis/PostDominators.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/Type.h"
+#include <algorithm>
 
+#include "dominance.h"
 #include "loop.h"
 #include "worklist.h"
 
@@ -33,14 +35,19 @@ typedef LoopInfoBase<BasicBlock,Loop> LoopInfoBase2;
 DEFINE_SIMPLE_CONVERSION_FUNCTIONS(LoopInfoBase2,LLVMLoopInfoRef)
 DEFINE_SIMPLE_CONVERSION_FUNCTIONS(Loop,LLVMLoopRef)
 
+/* The loops are found with the dominator tree cached in dominance.cpp;
+   the LoopInfo does not refer to it afterwards. */
 LLVMLoopInfoRef LLVMCreateLoopInfoRef(LLVMValueRef Fun) {
   LoopInfoBase<BasicBlock,Loop> *LI = new LoopInfoBase<BasicBlock,Loop>();
-  DominatorTreeBase<BasicBlock,false> *DT = new DominatorTreeBase<BasicBlock,false>();
-  DT->recalculate(*(Function*)unwrap(Fun));
-  LI->analyze(*DT);
+  LI->analyze(LLVMGetSharedDominatorTree((Function*)unwrap(Fun)));
   return wrap(LI);
 }
 
+void LLVMDisposeLoopInfoRef(LLVMLoopInfoRef LIRef)
+{
+  delete unwrap(LIRef);
+}
+
 LLVMLoopRef LLVMGetLoopRef(LLVMLoopInfoRef LIRef,LLVMBasicBlockRef BBRef)
 {
   LoopInfoBase<BasicBlock,Loop> *LI = unwrap(LIRef);
@@ -129,6 +136,77 @@ LLVMLoopRef LLVMGetNextLoop(LLVMLoopInfoRef LIRef, LLVMLoopRef Loop)
   return NULL;
 }
 
+unsigned LLVMCountLoops(LLVMLoopInfoRef LIRef)
+{
+  LoopInfoBase2 * LI = unwrap(LIRef);
+  return LI->getTopLevelLoops().size();
+}
+
+void LLVMGetLoops(LLVMLoopInfoRef LIRef, LLVMLoopRef *Loops)
+{
+  LoopInfoBase2 * LI = unwrap(LIRef);
+  for (Loop *L : *LI)
+    *Loops++ = wrap(L);
+}
+
+unsigned LLVMCountAllLoops(LLVMLoopInfoRef LIRef)
+{
+  LoopInfoBase2 * LI = unwrap(LIRef);
+  return LI->getLoopsInPreorder().size();
+}
+
+/* Every loop after all of its subloops */
+static void postorder(Loop *L, LLVMLoopRef *&Loops)
+{
+  for (Loop *Sub : *L)
+    postorder(Sub, Loops);
+  *Loops++ = wrap(L);
+}
+
+void LLVMGetLoopsInPostorder(LLVMLoopInfoRef LIRef, LLVMLoopRef *Loops)
+{
+  LoopInfoBase2 * LI = unwrap(LIRef);
+  for (Loop *L : *LI)
+    postorder(L, Loops);
+}
+
+void LLVMGetLoopsInnermostFirst(LLVMLoopInfoRef LIRef, LLVMLoopRef *Loops)
+{
+  LoopInfoBase2 * LI = unwrap(LIRef);
+  SmallVector<Loop*,16> All = LI->getLoopsInPreorder();
+  std::stable_sort(All.begin(), All.end(), [](Loop *A, Loop *B) {
+    return A->getLoopDepth() > B->getLoopDepth();
+  });
+  for (Loop *L : All)
+    *Loops++ = wrap(L);
+}
+
+LLVMLoopRef LLVMGetParentLoop(LLVMLoopRef L)
+{
+  return wrap(unwrap(L)->getParentLoop());
+}
+
+unsigned LLVMCountSubLoops(LLVMLoopRef L)
+{
+  return unwrap(L)->getSubLoops().size();
+}
+
+void LLVMGetSubLoops(LLVMLoopRef L, LLVMLoopRef *SubLoops)
+{
+  for (Loop *Sub : *unwrap(L))
+    *SubLoops++ = wrap(Sub);
+}
+
+unsigned LLVMGetLoopDepth(LLVMLoopRef L)
+{
+  return unwrap(L)->getLoopDepth();
+}
+
+LLVMBool LLVMIsInnermostLoop(LLVMLoopRef L)
+{
+  return unwrap(L)->isInnermost();
+}
+
 LLVMBool LLVMLoopContainsInst(LLVMLoopRef L, LLVMValueRef Insn)
 {
   Loop *l = unwrap(L);
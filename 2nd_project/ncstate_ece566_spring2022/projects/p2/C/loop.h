@@ -22,6 +22,7 @@ extern "C" {
   typedef struct LLVMOpaqueLoopRef* LLVMLoopRef;
 
   LLVMLoopInfoRef LLVMCreateLoopInfoRef(LLVMValueRef Function);
+  void LLVMDisposeLoopInfoRef(LLVMLoopInfoRef);
   LLVMLoopRef LLVMGetLoopRef(LLVMLoopInfoRef,LLVMBasicBlockRef);
   worklist_t LLVMGetBlocksInLoop(LLVMLoopRef);
   worklist_t LLVMGetExitBlocks(LLVMLoopRef);
@@ -30,6 +31,27 @@ extern "C" {
   LLVMLoopRef LLVMGetFirstLoop(LLVMLoopInfoRef LIRef);
   LLVMLoopRef LLVMGetNextLoop(LLVMLoopInfoRef LIRef, LLVMLoopRef Loop);
 
+  /* LLVMGetNextLoop searches for Loop, so walking all N top-level loops
+     with it is O(N^2). This fills Loops with LLVMCountLoops(LIRef) loops
+     in O(N). */
+  unsigned LLVMCountLoops(LLVMLoopInfoRef LIRef);
+  void LLVMGetLoops(LLVMLoopInfoRef LIRef, LLVMLoopRef *Loops);
+
+  /* Walks of every loop of every nest, filling LLVMCountAllLoops(LIRef)
+     entries. Postorder puts each loop after its subloops; innermost-first
+     orders all loops by decreasing depth. */
+  unsigned LLVMCountAllLoops(LLVMLoopInfoRef LIRef);
+  void LLVMGetLoopsInPostorder(LLVMLoopInfoRef LIRef, LLVMLoopRef *Loops);
+  void LLVMGetLoopsInnermostFirst(LLVMLoopInfoRef LIRef, LLVMLoopRef *Loops);
+
+  /* The loop nest around a loop. Top-level loops have no parent (NULL)
+     and depth 1. */
+  LLVMLoopRef LLVMGetParentLoop(LLVMLoopRef);
+  unsigned LLVMCountSubLoops(LLVMLoopRef);
+  void LLVMGetSubLoops(LLVMLoopRef, LLVMLoopRef *SubLoops);
+  unsigned LLVMGetLoopDepth(LLVMLoopRef);
+  LLVMBool LLVMIsInnermostLoop(LLVMLoopRef);
+
   LLVMBasicBlockRef LLVMGetPreheader(LLVMLoopRef);
   LLVMBasicBlockRef LLVMGetDedicatedExit(LLVMLoopRef);
 
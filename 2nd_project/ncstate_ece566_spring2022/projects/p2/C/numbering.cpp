@@ -0,0 +1,133 @@
+/*
+ * File: numbering.cpp
+ *
+ * Description:
+ *   This numbers the blocks and instructions of a function densely, so
+ *   that C passes can keep per-value data in flat arrays.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory>
+#include <vector>
+
+/* LLVM Header Files */
+#include "llvm-c/Core.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/CBindingWrapping.h"
+
+#include "numbering.h"
+
+using namespace llvm;
+
+namespace {
+struct Numbering {
+  Function *F;
+  bool Valid;
+  std::vector<BasicBlock*> Blocks;
+  std::vector<Instruction*> Instructions;
+  DenseMap<const Value*,unsigned> Numbers;
+
+  Numbering(Function *F) : F(F), Valid(false) {}
+
+  Numbering &update()
+  {
+    if (Valid)
+      return *this;
+
+    Blocks.clear();
+    Instructions.clear();
+    Numbers.clear();
+    for (BasicBlock &BB : *F)
+      {
+	Numbers[&BB] = Blocks.size();
+	Blocks.push_back(&BB);
+	for (Instruction &I : BB)
+	  {
+	    Numbers[&I] = Instructions.size();
+	    Instructions.push_back(&I);
+	  }
+      }
+    Valid = true;
+    return *this;
+  }
+
+  unsigned number(const Value *V)
+  {
+    auto it = update().Numbers.find(V);
+    return it == Numbers.end() ? LLVM_NO_NUMBER : it->second;
+  }
+};
+}
+
+DEFINE_SIMPLE_CONVERSION_FUNCTIONS(Numbering,LLVMNumberingRef)
+
+// The numbering of every function numbered so far. A Numbering stays at
+// the same address when it is rebuilt, so LLVMNumberingRefs remain usable
+// after LLVMInvalidateNumbering.
+static DenseMap<Function*, std::unique_ptr<Numbering>> Numberings;
+
+LLVMNumberingRef LLVMNumberFunction(LLVMValueRef Fun)
+{
+  Function *F = (Function*)unwrap(Fun);
+  std::unique_ptr<Numbering> &N = Numberings[F];
+  if (N == NULL)
+    N.reset(new Numbering(F));
+  return wrap(&N->update());
+}
+
+void LLVMInvalidateNumbering(LLVMValueRef Fun)
+{
+  if (Fun == NULL)
+    {
+      Numberings.clear();
+      return;
+    }
+
+  auto it = Numberings.find((Function*)unwrap(Fun));
+  if (it != Numberings.end())
+    it->second->Valid = false;
+}
+
+unsigned LLVMNumberingBlockCount(LLVMNumberingRef N)
+{
+  return unwrap(N)->update().Blocks.size();
+}
+
+unsigned LLVMNumberingInstructionCount(LLVMNumberingRef N)
+{
+  return unwrap(N)->update().Instructions.size();
+}
+
+unsigned LLVMGetBlockNumber(LLVMNumberingRef N, LLVMBasicBlockRef BB)
+{
+  return unwrap(N)->number(unwrap(BB));
+}
+
+unsigned LLVMGetInstructionNumber(LLVMNumberingRef N, LLVMValueRef I)
+{
+  return unwrap(N)->number(unwrap(I));
+}
+
+LLVMBasicBlockRef LLVMGetNumberedBlock(LLVMNumberingRef N, unsigned Number)
+{
+  return wrap(unwrap(N)->update().Blocks[Number]);
+}
+
+LLVMValueRef LLVMGetNumberedInstruction(LLVMNumberingRef N, unsigned Number)
+{
+  return wrap(unwrap(N)->update().Instructions[Number]);
+}
+
+sidetable_t sidetable_create(unsigned size)
+{
+  return (sidetable_t)calloc(size ? size : 1, sizeof(void*));
+}
+
+void sidetable_destroy(sidetable_t table)
+{
+  free(table);
+}
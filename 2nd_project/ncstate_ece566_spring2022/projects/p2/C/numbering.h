@@ -0,0 +1,46 @@
+#ifndef NUMBERING_H
+#define NUMBERING_H
+
+#include "llvm-c/DataTypes.h"
+#include "llvm-c/ExternC.h"
+#include "llvm-c/Types.h"
+
+LLVM_C_EXTERN_C_BEGIN
+
+/* Dense numbers for the blocks and instructions of a function, in program
+   order: blocks are 0..LLVMNumberingBlockCount-1 and instructions
+   0..LLVMNumberingInstructionCount-1. Per-block and per-instruction data
+   can then live in a flat side table indexed by number instead of a
+   valmap_t.
+
+   The numbering of a function is cached. Call LLVMInvalidateNumbering
+   after adding or removing blocks or instructions; the next query numbers
+   the function again. NULL drops the numbering of every function. */
+typedef struct LLVMOpaqueNumbering *LLVMNumberingRef;
+
+#define LLVM_NO_NUMBER ((unsigned)-1)
+
+LLVMNumberingRef LLVMNumberFunction(LLVMValueRef Fun);
+void LLVMInvalidateNumbering(LLVMValueRef Fun);
+
+unsigned LLVMNumberingBlockCount(LLVMNumberingRef N);
+unsigned LLVMNumberingInstructionCount(LLVMNumberingRef N);
+
+/* LLVM_NO_NUMBER for a block or instruction added since the numbering was
+   built */
+unsigned LLVMGetBlockNumber(LLVMNumberingRef N, LLVMBasicBlockRef BB);
+unsigned LLVMGetInstructionNumber(LLVMNumberingRef N, LLVMValueRef I);
+
+LLVMBasicBlockRef LLVMGetNumberedBlock(LLVMNumberingRef N, unsigned Number);
+LLVMValueRef LLVMGetNumberedInstruction(LLVMNumberingRef N, unsigned Number);
+
+/* A side table is a plain array of size entries, all NULL at first;
+   index it with the numbers above. */
+typedef void **sidetable_t;
+
+sidetable_t sidetable_create(unsigned size);
+void sidetable_destroy(sidetable_t);
+
+LLVM_C_EXTERN_C_END
+
+#endif
@@ -4,8 +4,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <chrono>
+#include <deque>
+#include <time.h>
 
 #include "llvm-c/Core.h"
+#include "dominance.h"
+#include "gcm.h"
+#include "licm.h"
+#include "numbering.h"
+#include "ivsr.h"
+#include "profile.h"
+#include "sccp.h"
+#include "stats.h"
+#include "summary.h"
 
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -22,6 +34,7 @@
 #include "llvm/LinkAllPasses.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace llvm;
 
@@ -36,18 +49,65 @@ static cl::opt<std::string>
         InputFilename(cl::Positional, cl::desc("<input bitcode>"), cl::Required, cl::init("-"));
 
 static cl::opt<std::string>
-        OutputFilename(cl::Positional, cl::desc("<output bitcode>"), cl::Required, cl::init("out.bc"));
+        OutputFilename(cl::Positional, cl::desc("<output bitcode>"), cl::Optional, cl::init("out.bc"));
+
+static cl::opt<std::string>
+        OutputOption("o",
+                     cl::desc("Write the output bitcode to <file>, for use as the PROFILER of wolfbench."),
+                     cl::value_desc("file"),
+                     cl::init(""));
 
 static cl::opt<bool>
         Mem2Reg("mem2reg",
                 cl::desc("Perform memory to register promotion before CSE."),
                 cl::init(false));
 
+static cl::opt<bool>
+        SCCP("sccp",
+             cl::desc("Perform sparse conditional constant propagation before CSE."),
+             cl::init(false));
+
 static cl::opt<bool>
         NoCSE("no-cse",
               cl::desc("Do not perform CSE Optimization."),
               cl::init(false));
 
+static cl::opt<bool>
+        LICM("licm",
+             cl::desc("Perform loop-invariant code motion after CSE."),
+             cl::init(false));
+
+static cl::opt<bool>
+        IVSR("ivsr",
+             cl::desc("Perform induction-variable strength reduction and widening after LICM."),
+             cl::init(false));
+
+static cl::opt<bool>
+        GCM("gcm",
+            cl::desc("Perform global code motion, last, placing code by block frequency."),
+            cl::init(false));
+
+static cl::opt<bool>
+        DoProfile("do-profile",
+                  cl::desc("Instrument the output to count edges and write the profile file at exit."),
+                  cl::init(false));
+
+static cl::opt<bool>
+        UseProfile("use-profile",
+                   cl::desc("Read the profile file into branch weights and the block counts of -gcm."),
+                   cl::init(false));
+
+static cl::opt<std::string>
+        ProfileFilename("profile-file",
+                        cl::desc("Profile file of -do-profile and -use-profile (default p2.prof)."),
+                        cl::value_desc("file"),
+                        cl::init("p2.prof"));
+
+static cl::opt<bool>
+        Summary("summary",
+                cl::desc("Print the module summary to stdout."),
+                cl::init(false));
+
 static cl::opt<bool>
         Verbose("verbose",
                     cl::desc("Verbose stats."),
@@ -58,9 +118,76 @@ static cl::opt<bool>
                 cl::desc("Do not check for valid IR."),
                 cl::init(false));
 
+static cl::opt<unsigned>
+        Jobs("j",
+             cl::desc("Profile the functions of the module on N threads (0: one per core)."),
+             cl::value_desc("N"),
+             cl::init(1));
+
+static cl::opt<std::string>
+        TraceFilename("trace",
+                      cl::desc("Write a Chrome trace-event JSON of the phases to <file>."),
+                      cl::value_desc("file"),
+                      cl::init(""));
+
+namespace {
+// Wall-clock and CPU time spent in one phase, in microseconds.
+struct PhaseTime {
+    uint64_t Wall = 0;
+    uint64_t CPU = 0;
+};
+}
+
+// Time of each phase of the tool, in the order the phases first ran. It is
+// a deque so that a running PhaseTimer keeps its entry when phases are added.
+static std::deque<std::pair<StringRef, PhaseTime>> PhaseTimes;
+
+static PhaseTime &phaseTime(StringRef Name) {
+    for (auto &P : PhaseTimes)
+        if (P.first == Name)
+            return P.second;
+    PhaseTimes.emplace_back(Name, PhaseTime());
+    return PhaseTimes.back().second;
+}
+
+static uint64_t wallMicros() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t cpuMicros() {
+    timespec TS;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &TS);
+    return uint64_t(TS.tv_sec) * 1000000 + TS.tv_nsec / 1000;
+}
+
+namespace {
+// Adds the wall-clock and CPU time of the enclosing scope to a phase and,
+// with -trace, records the scope as a trace event. Spans inside the C CSE
+// code come from LLVMTimeTraceBegin/End in stats.h.
+class PhaseTimer {
+    PhaseTime &Into;
+    uint64_t WallStart;
+    uint64_t CPUStart;
+    TimeTraceScope Trace;
+
+public:
+    PhaseTimer(StringRef Name, StringRef Detail = "")
+        : Into(phaseTime(Name)), WallStart(wallMicros()),
+          CPUStart(cpuMicros()), Trace(Name, Detail) {}
+
+    ~PhaseTimer() {
+        Into.Wall += wallMicros() - WallStart;
+        Into.CPU += cpuMicros() - CPUStart;
+    }
+};
+}
+
 int main(int argc, char **argv) {
     // Parse command line arguments
     cl::ParseCommandLineOptions(argc, argv, "llvm system compiler\n");
+    if (!OutputOption.empty())
+        OutputFilename = OutputOption.getValue();
 
     // Handle creating output files and shutting down properly
     llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
@@ -74,11 +201,16 @@ int main(int argc, char **argv) {
                                  sys::fs::OF_None));
 
     EnableStatistics();
+    if (!TraceFilename.empty())
+        timeTraceProfilerInitialize(0, argv[0]);
 
     // Read in module
     SMDiagnostic Err;
     std::unique_ptr<Module> M;
-    M = parseIRFile(InputFilename, Err, Context);
+    {
+        PhaseTimer Timer("parseIRFile", InputFilename);
+        M = parseIRFile(InputFilename, Err, Context);
+    }
 
     // If errors, fail
     if (M.get() == 0)
@@ -90,18 +222,62 @@ int main(int argc, char **argv) {
     // If requested, do some early optimizations
     if (Mem2Reg)
     {
+        PhaseTimer Timer("mem2reg");
         legacy::PassManager Passes;
         Passes.add(createPromoteMemoryToRegisterPass());
         Passes.run(*M.get());
+        // mem2reg deletes loads, stores and allocas behind the C passes' back
+        LLVMInvalidateNumbering(NULL);
+    }
+
+    if (SCCP) {
+        PhaseTimer Timer("SCCP");
+        SparseConditionalConstantPropagation(wrap(M.get()));
     }
 
     if (!NoCSE) {
+        PhaseTimer Timer("CSE");
         CommonSubexpressionElimination(wrap(M.get()));
     }
 
+    if (LICM) {
+        PhaseTimer Timer("LICM");
+        LoopInvariantCodeMotion(wrap(M.get()));
+    }
+
+    if (IVSR) {
+        PhaseTimer Timer("IVSR");
+        InductionVariableStrengthReduction(wrap(M.get()));
+    }
+
+    if (UseProfile) {
+        PhaseTimer Timer("use-profile");
+        char *Message;
+        if (LLVMLoadEdgeProfile(wrap(M.get()), ProfileFilename.c_str(), &Message)) {
+            errs() << argv[0] << ": " << Message << "\n";
+            LLVMDisposeMessage(Message);
+            return 1;
+        }
+    }
+
+    if (GCM) {
+        PhaseTimer Timer("GCM");
+        GlobalCodeMotion(wrap(M.get()));
+    }
+    LLVMStatisticsMerge();
+
     // Collect statistics on Module
-    summarize(M.get());
-    print_csv_file(OutputFilename+".stats");
+    {
+        PhaseTimer Timer("summarize");
+        summarize(M.get());
+    }
+
+    // Instrument last, so that the counters see the code as it will run
+    // and the summary does not count them.
+    if (DoProfile) {
+        PhaseTimer Timer("do-profile");
+        LLVMInstrumentEdgeProfile(wrap(M.get()), ProfileFilename.c_str());
+    }
 
     if (Verbose)
         PrintStatistics(errs());
@@ -109,15 +285,33 @@ int main(int argc, char **argv) {
     // Verify integrity of Module, do this by default
     if (!NoCheck)
     {
+        PhaseTimer Timer("verifier");
         legacy::PassManager Passes;
         Passes.add(createVerifierPass());
         Passes.run(*M.get());
+        // The dominator trees the passes kept up to date must match the CFG
+        if (LLVMVerifyDominators(NULL)) {
+            errs() << argv[0] << ": dominator tree out of date\n";
+            return 1;
+        }
     }
 
     // Write final bitcode
-    WriteBitcodeToFile(*M.get(), Out->os());
+    {
+        PhaseTimer Timer("WriteBitcodeToFile");
+        WriteBitcodeToFile(*M.get(), Out->os());
+    }
     Out->keep();
 
+    // The stats go out last so that they include the time of every phase.
+    print_csv_file(OutputFilename+".stats");
+
+    if (!TraceFilename.empty()) {
+        if (Error E = timeTraceProfilerWrite(TraceFilename, OutputFilename))
+            logAllUnhandledErrors(std::move(E), errs(), "p2: ");
+        timeTraceProfilerCleanup();
+    }
+
     return 0;
 }
 
@@ -126,23 +320,24 @@ static llvm::Statistic nInstructions = {"", "Instructions", "number of instructi
 static llvm::Statistic nLoads = {"", "Loads", "number of loads"};
 static llvm::Statistic nStores = {"", "Stores", "number of stores"};
 
+// Profile the module with the summary.c profiler. The counts the .stats
+// file always had stay there; the full profile goes next to it as
+// <output>.summary.csv and <output>.summary.json.
 static void summarize(Module *M) {
-    for (auto i = M->begin(); i != M->end(); i++) {
-        if (i->begin() != i->end()) {
-            nFunctions++;
-        }
-        for (auto j = i->begin(); j != i->end(); j++) {
-            for (auto k = j->begin(); k != j->end(); k++) {
-                Instruction &I = *k;
-                nInstructions++;
-                if (isa<LoadInst>(&I)) {
-                    nLoads++;
-                } else if (isa<StoreInst>(&I)) {
-                    nStores++;
-                }
-            }
-        }
-    }
+    Stats S;
+    SummarizeModule(wrap(M), &S, Jobs);
+
+    nFunctions += S.functions;
+    nInstructions += S.insns;
+    nLoads += S.loads;
+    nStores += S.stores;
+
+    if (Verbose)
+        summary_pretty_print(stderr, S, 2);
+    if (Summary)
+        summary_pretty_print(stdout, S, 0);
+    summary_print_csv((OutputFilename + ".summary.csv").c_str(), S, InputFilename.c_str());
+    summary_print_json((OutputFilename + ".summary.json").c_str(), S, InputFilename.c_str());
 }
 
 static void print_csv_file(std::string outputfile)
@@ -152,6 +347,11 @@ static void print_csv_file(std::string outputfile)
     for (auto p : a) {
         stats << p.first.str() << "," << p.second << std::endl;
     }
+    LLVMHistogramsPrint(stats);
+    for (auto &P : PhaseTimes) {
+        stats << "Time." << P.first.str() << ".WallUs," << P.second.Wall << std::endl;
+        stats << "Time." << P.first.str() << ".CPUUs," << P.second.CPU << std::endl;
+    }
     stats.close();
 }
 
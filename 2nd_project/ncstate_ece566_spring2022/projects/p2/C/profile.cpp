@@ -0,0 +1,461 @@
+/*
+ * File: profile.cpp
+ *
+ * Description:
+ *   Edge profiling for the C passes: counters on a spanning-tree
+ *   complement of each CFG, reading the counts back, and block
+ *   frequencies from the profile or from LLVM's estimate.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/* LLVM Header Files */
+#include "llvm-c/Core.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Support/CBindingWrapping.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+
+#include "dominance.h"
+#include "profile.h"
+
+using namespace llvm;
+
+namespace {
+/* The estimate of one function. The BranchProbabilityInfo and LoopInfo
+   must live as long as the BlockFrequencyInfo built from them. */
+struct Estimate {
+  LoopInfo LI;
+  BranchProbabilityInfo BPI;
+  BlockFrequencyInfo BFI;
+
+  Estimate(Function &F)
+    : LI(LLVMGetSharedDominatorTree(&F)), BPI(F, LI), BFI(F, BPI, LI) {}
+};
+
+/* An edge of the closed CFG. Nodes are the blocks in layout order and a
+   virtual exit node after them; Succ is the successor number of a real
+   edge. */
+struct ProfileEdge {
+  unsigned From, To;
+  unsigned Succ;
+  bool InTree;
+};
+
+/* The edges of one function and which of them are counted, in counter
+   order. A function whose off-tree edges include one that can be
+   neither counted in place nor split gets no counters. */
+struct EdgePlan {
+  std::vector<BasicBlock*> Blocks;
+  std::vector<ProfileEdge> Edges;
+  std::vector<unsigned> Counters;
+};
+}
+
+static DenseMap<const Function*, DenseMap<const BasicBlock*, uint64_t>> Counts;
+static DenseMap<const Function*, std::unique_ptr<Estimate>> Estimates;
+
+static Estimate &getEstimate(Function *F)
+{
+  std::unique_ptr<Estimate> &E = Estimates[F];
+  if (E == NULL)
+    E.reset(new Estimate(*F));
+  return *E;
+}
+
+static bool isExitEdge(const EdgePlan &P, const ProfileEdge &E)
+{
+  return E.To == P.Blocks.size();
+}
+
+/* A counter on an edge goes at the end of its source or the start of its
+   destination when either is the only one; otherwise the edge must be
+   split, which indirectbr, callbr and EH pads do not allow. */
+static bool needsSplit(const EdgePlan &P, const ProfileEdge &E)
+{
+  if (E.From == P.Blocks.size() || isExitEdge(P, E))
+    return false;
+  BasicBlock *From = P.Blocks[E.From], *To = P.Blocks[E.To];
+  return From->getTerminator()->getNumSuccessors() > 1
+    && To->getSinglePredecessor() == NULL;
+}
+
+static bool canSplit(const EdgePlan &P, const ProfileEdge &E)
+{
+  BasicBlock *From = P.Blocks[E.From], *To = P.Blocks[E.To];
+  return !isa<IndirectBrInst>(From->getTerminator())
+    && !isa<CallBrInst>(From->getTerminator()) && !To->isEHPad();
+}
+
+static EdgePlan planEdges(Function &F)
+{
+  EdgePlan P;
+  DenseMap<const BasicBlock*, unsigned> Number;
+  for (BasicBlock &BB : F)
+    {
+      Number[&BB] = P.Blocks.size();
+      P.Blocks.push_back(&BB);
+    }
+  unsigned Exit = P.Blocks.size();
+
+  /* Weights: the edges that must not get a counter first, then the most
+     frequent edges by the static estimate, so the counters land on the
+     cold edges. */
+  Estimate &E = getEstimate(&F);
+  std::vector<uint64_t> Weight;
+  P.Edges.push_back({Exit, 0, 0, false});
+  Weight.push_back(UINT64_MAX);
+  for (BasicBlock *BB : P.Blocks)
+    {
+      Instruction *Term = BB->getTerminator();
+      uint64_t Freq = E.BFI.getBlockFreq(BB).getFrequency();
+      if (Term->getNumSuccessors() == 0)
+	{
+	  /* A block ending in unreachable usually follows a call that does
+	     not return, so a counter before its terminator would not run. */
+	  P.Edges.push_back({Number[BB], Exit, 0, false});
+	  Weight.push_back(isa<UnreachableInst>(Term) ? UINT64_MAX : Freq);
+	  continue;
+	}
+      for (unsigned S = 0; S < Term->getNumSuccessors(); S++)
+	{
+	  P.Edges.push_back({Number[BB], Number[Term->getSuccessor(S)], S, false});
+	  if (needsSplit(P, P.Edges.back()) && !canSplit(P, P.Edges.back()))
+	    Weight.push_back(UINT64_MAX);
+	  else
+	    Weight.push_back(E.BPI.getEdgeProbability(BB, S).scale(Freq));
+	}
+    }
+
+  std::vector<unsigned> Order(P.Edges.size());
+  std::iota(Order.begin(), Order.end(), 0);
+  std::stable_sort(Order.begin(), Order.end(), [&](unsigned A, unsigned B) {
+    return Weight[A] > Weight[B];
+  });
+
+  EquivalenceClasses<unsigned> Trees;
+  for (unsigned N = 0; N <= Exit; N++)
+    Trees.insert(N);
+  for (unsigned I : Order)
+    {
+      ProfileEdge &Edge = P.Edges[I];
+      if (Trees.findLeader(Edge.From) != Trees.findLeader(Edge.To))
+	{
+	  Trees.unionSets(Edge.From, Edge.To);
+	  Edge.InTree = true;
+	}
+    }
+
+  for (unsigned I = 0; I < P.Edges.size(); I++)
+    {
+      if (P.Edges[I].InTree)
+	continue;
+      if (needsSplit(P, P.Edges[I]) && !canSplit(P, P.Edges[I]))
+	{
+	  P.Counters.clear();
+	  break;
+	}
+      P.Counters.push_back(I);
+    }
+  return P;
+}
+
+/* Edges are planned on every function before the first one is changed. */
+static std::vector<std::pair<Function*, EdgePlan>> planModule(Module *M)
+{
+  std::vector<std::pair<Function*, EdgePlan>> Plans;
+  for (Function &F : *M)
+    if (!F.isDeclaration() && F.hasName())
+      Plans.emplace_back(&F, planEdges(F));
+  return Plans;
+}
+
+void LLVMInstrumentEdgeProfile(LLVMModuleRef ModuleRef, const char *ProfileFile)
+{
+  Module *M = unwrap(ModuleRef);
+  LLVMContext &Ctx = M->getContext();
+  auto Plans = planModule(M);
+
+  unsigned Total = 0;
+  for (auto &P : Plans)
+    Total += P.second.Counters.size();
+  if (Total == 0)
+    return;
+
+  Type *Int64 = Type::getInt64Ty(Ctx);
+  ArrayType *CountersTy = ArrayType::get(Int64, Total);
+  GlobalVariable *Counters =
+    new GlobalVariable(*M, CountersTy, false, GlobalValue::InternalLinkage,
+		       Constant::getNullValue(CountersTy), "__p2_edge_counters");
+
+  unsigned First = 0;
+  for (auto &FP : Plans)
+    {
+      EdgePlan &P = FP.second;
+      for (unsigned C = 0; C < P.Counters.size(); C++)
+	{
+	  ProfileEdge &E = P.Edges[P.Counters[C]];
+	  BasicBlock *From = P.Blocks[E.From];
+	  Instruction *At;
+	  if (isExitEdge(P, E) || From->getTerminator()->getNumSuccessors() == 1)
+	    At = From->getTerminator();
+	  else if (!needsSplit(P, E))
+	    At = &*P.Blocks[E.To]->getFirstInsertionPt();
+	  else
+	    {
+	      BasicBlock *To = P.Blocks[E.To];
+	      BasicBlock *Split = SplitCriticalEdge(From->getTerminator(), E.Succ);
+	      LLVMDominatorsInsertEdge(wrap(From), wrap(Split));
+	      LLVMDominatorsInsertEdge(wrap(Split), wrap(To));
+	      /* A switch may have other edges to To that stay */
+	      if (!is_contained(successors(From), To))
+		LLVMDominatorsDeleteEdge(wrap(From), wrap(To));
+	      At = Split->getTerminator();
+	    }
+
+	  IRBuilder<> B(At);
+	  Value *Ptr = B.CreateConstInBoundsGEP2_64(CountersTy, Counters, 0, First + C);
+	  B.CreateStore(B.CreateAdd(B.CreateLoad(Int64, Ptr), B.getInt64(1)), Ptr);
+	}
+      if (!P.Counters.empty())
+	{
+	  LLVMInvalidateBlockFrequencies(wrap(FP.first));
+	}
+      First += P.Counters.size();
+    }
+
+  /* The runtime: fprintf every counter when the program exits. */
+  Type *Ptr = Type::getInt8PtrTy(Ctx);
+  FunctionCallee FOpen = M->getOrInsertFunction("fopen", Ptr, Ptr, Ptr);
+  FunctionCallee FPrintf = M->getOrInsertFunction(
+    "fprintf", FunctionType::get(Type::getInt32Ty(Ctx), {Ptr, Ptr}, true));
+  FunctionCallee FClose = M->getOrInsertFunction("fclose", Type::getInt32Ty(Ctx), Ptr);
+
+  Function *Dump = Function::Create(FunctionType::get(Type::getVoidTy(Ctx), false),
+				    GlobalValue::InternalLinkage, "__p2_profile_dump", M);
+  BasicBlock *Entry = BasicBlock::Create(Ctx, "entry", Dump);
+  BasicBlock *Write = BasicBlock::Create(Ctx, "write", Dump);
+  BasicBlock *Done = BasicBlock::Create(Ctx, "done", Dump);
+  IRBuilder<> B(Entry);
+  Value *File = B.CreateCall(FOpen, {B.CreateGlobalStringPtr(ProfileFile),
+				     B.CreateGlobalStringPtr("w")});
+  B.CreateCondBr(B.CreateIsNull(File), Done, Write);
+
+  B.SetInsertPoint(Write);
+  Value *Format = B.CreateGlobalStringPtr("%s %u %llu\n");
+  First = 0;
+  for (auto &FP : Plans)
+    {
+      if (FP.second.Counters.empty())
+	continue;
+      Value *Name = B.CreateGlobalStringPtr(FP.first->getName());
+      for (unsigned C = 0; C < FP.second.Counters.size(); C++)
+	{
+	  Value *Count = B.CreateLoad(Int64, B.CreateConstInBoundsGEP2_64(
+					CountersTy, Counters, 0, First + C));
+	  B.CreateCall(FPrintf, {File, Format, Name, B.getInt32(C), Count});
+	}
+      First += FP.second.Counters.size();
+    }
+  B.CreateCall(FClose, {File});
+  B.CreateBr(Done);
+
+  B.SetInsertPoint(Done);
+  B.CreateRetVoid();
+  appendToGlobalDtors(*M, Dump, 0);
+}
+
+static LLVMBool profileError(char **OutMessage, const std::string &Msg)
+{
+  if (OutMessage)
+    *OutMessage = strdup(Msg.c_str());
+  return 1;
+}
+
+/* Fill in the tree edges from the counted ones: a node with one unknown
+   edge left gets it from the flow through the node. */
+static std::vector<uint64_t> solveEdges(const EdgePlan &P,
+					const std::vector<uint64_t> &Raw)
+{
+  unsigned Nodes = P.Blocks.size() + 1;
+  std::vector<uint64_t> Count(P.Edges.size(), 0);
+  std::vector<bool> Known(P.Edges.size(), false);
+  std::vector<SmallVector<unsigned,4>> Incident(Nodes);
+  std::vector<unsigned> Unknown(Nodes, 0);
+
+  for (unsigned C = 0; C < P.Counters.size(); C++)
+    {
+      Count[P.Counters[C]] = Raw[C];
+      Known[P.Counters[C]] = true;
+    }
+  for (unsigned I = 0; I < P.Edges.size(); I++)
+    {
+      const ProfileEdge &E = P.Edges[I];
+      if (E.From == E.To)
+	continue;
+      Incident[E.From].push_back(I);
+      Incident[E.To].push_back(I);
+      if (!Known[I])
+	{
+	  Unknown[E.From]++;
+	  Unknown[E.To]++;
+	}
+    }
+
+  std::vector<unsigned> Ready;
+  for (unsigned N = 0; N < Nodes; N++)
+    if (Unknown[N] == 1)
+      Ready.push_back(N);
+  while (!Ready.empty())
+    {
+      unsigned N = Ready.back();
+      Ready.pop_back();
+      if (Unknown[N] != 1)
+	continue;
+
+      uint64_t In = 0, Out = 0;
+      unsigned Missing = 0;
+      for (unsigned I : Incident[N])
+	{
+	  if (!Known[I])
+	    Missing = I;
+	  else if (P.Edges[I].To == N)
+	    In += Count[I];
+	  else
+	    Out += Count[I];
+	}
+      /* Calls that exit the program can leave less flow out than in. */
+      if (P.Edges[Missing].To == N)
+	Count[Missing] = Out > In ? Out - In : 0;
+      else
+	Count[Missing] = In > Out ? In - Out : 0;
+      Known[Missing] = true;
+
+      for (unsigned End : {P.Edges[Missing].From, P.Edges[Missing].To})
+	if (--Unknown[End] == 1)
+	  Ready.push_back(End);
+    }
+  return Count;
+}
+
+static void applyCounts(Function *F, const EdgePlan &P,
+			const std::vector<uint64_t> &Count)
+{
+  MDBuilder MDB(F->getContext());
+  DenseMap<const BasicBlock*, uint64_t> &Blocks = Counts[F];
+  std::vector<SmallVector<uint64_t,2>> Weights(P.Blocks.size());
+
+  for (unsigned I = 0; I < P.Edges.size(); I++)
+    {
+      const ProfileEdge &E = P.Edges[I];
+      if (!isExitEdge(P, E))
+	Blocks[P.Blocks[E.To]] += Count[I];
+      if (E.From != P.Blocks.size() && !isExitEdge(P, E))
+	{
+	  Weights[E.From].resize(E.Succ + 1);
+	  Weights[E.From][E.Succ] = Count[I];
+	}
+    }
+
+  for (unsigned N = 0; N < P.Blocks.size(); N++)
+    {
+      Instruction *Term = P.Blocks[N]->getTerminator();
+      if (Weights[N].size() < 2 || !(isa<BranchInst>(Term) || isa<SwitchInst>(Term)))
+	continue;
+      uint64_t Max = *std::max_element(Weights[N].begin(), Weights[N].end());
+      uint64_t Scale = Max / UINT32_MAX + 1;
+      SmallVector<uint32_t,2> W;
+      for (uint64_t C : Weights[N])
+	W.push_back(C / Scale);
+      Term->setMetadata(LLVMContext::MD_prof, MDB.createBranchWeights(W));
+    }
+}
+
+LLVMBool LLVMLoadEdgeProfile(LLVMModuleRef ModuleRef, const char *Filename,
+                             char **OutMessage)
+{
+  Module *M = unwrap(ModuleRef);
+  auto Buffer = MemoryBuffer::getFile(Filename);
+  if (!Buffer)
+    return profileError(OutMessage, std::string(Filename) + ": "
+                        + Buffer.getError().message());
+
+  auto Plans = planModule(M);
+  DenseMap<const Function*, unsigned> Plan;
+  for (unsigned I = 0; I < Plans.size(); I++)
+    Plan[Plans[I].first] = I;
+
+  std::vector<std::vector<uint64_t>> Raw(Plans.size());
+  for (line_iterator Line(**Buffer, true, '#'); !Line.is_at_end(); ++Line)
+    {
+      std::string Where = std::string(Filename) + ":"
+	+ std::to_string(Line.line_number()) + ": ";
+      StringRef Name, Counter, Count;
+      std::tie(Name, Counter) = getToken(*Line);
+      std::tie(Counter, Count) = getToken(Counter);
+      Count = Count.trim();
+
+      unsigned C;
+      uint64_t N;
+      if (Counter.getAsInteger(10, C) || Count.getAsInteger(10, N))
+	return profileError(OutMessage, Where + "expected <function> <counter> <count>");
+
+      Function *F = M->getFunction(Name);
+      auto It = F ? Plan.find(F) : Plan.end();
+      if (It == Plan.end() || C >= Plans[It->second].second.Counters.size())
+	return profileError(OutMessage, Where + "the profile does not match the module");
+
+      std::vector<uint64_t> &Counters = Raw[It->second];
+      Counters.resize(Plans[It->second].second.Counters.size());
+      Counters[C] += N;
+    }
+
+  Counts.clear();
+  for (unsigned I = 0; I < Plans.size(); I++)
+    if (!Raw[I].empty())
+      applyCounts(Plans[I].first, Plans[I].second,
+		  solveEdges(Plans[I].second, Raw[I]));
+
+  /* The new branch weights change the estimates too. */
+  LLVMInvalidateBlockFrequencies(NULL);
+  return 0;
+}
+
+uint64_t LLVMGetBlockFrequency(LLVMBasicBlockRef BBRef)
+{
+  BasicBlock *BB = unwrap(BBRef);
+  Function *F = BB->getParent();
+
+  auto Profiled = Counts.find(F);
+  if (Profiled != Counts.end())
+    return Profiled->second.lookup(BB);
+  return getEstimate(F).BFI.getBlockFreq(BB).getFrequency();
+}
+
+void LLVMInvalidateBlockFrequencies(LLVMValueRef Fun)
+{
+  if (Fun == NULL)
+    Estimates.clear();
+  else
+    Estimates.erase(unwrap<Function>(Fun));
+}
@@ -0,0 +1,44 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "llvm-c/DataTypes.h"
+#include "llvm-c/ExternC.h"
+#include "llvm-c/Types.h"
+
+LLVM_C_EXTERN_C_BEGIN
+
+/* Edge profiling. Each function's CFG, closed by a virtual edge from its
+   returns back to its entry, gets a maximum spanning tree weighted by
+   LLVM's static frequency estimate; only the edges off the tree get a
+   counter, since the tree edges follow from them by flow conservation.
+   Instrumenting and reading must see the same code, so run the same
+   passes before both.
+
+   LLVMInstrumentEdgeProfile adds the counters to Module and a destructor
+   that writes them, when the program exits, to ProfileFile:
+
+     <function> <counter> <count>
+
+   one line per counter. */
+void LLVMInstrumentEdgeProfile(LLVMModuleRef Module, const char *ProfileFile);
+
+/* Read a profile written by an instrumented build of Module, attach the
+   edge counts to its branches as branch_weights metadata and keep the
+   block counts for LLVMGetBlockFrequency. Counts for the same counter are
+   added, so profiles of several runs may be concatenated. Returns 1 and
+   sets *OutMessage, to be freed with LLVMDisposeMessage, if the file
+   cannot be read or does not match Module. */
+LLVMBool LLVMLoadEdgeProfile(LLVMModuleRef Module, const char *Filename,
+                             char **OutMessage);
+
+/* How often BB runs. For a function in the loaded profile this is its
+   count. Otherwise it is LLVM's static estimate, relative to the entry
+   block, which follows any branch_weights metadata in the function.
+   Estimates are cached per function; call LLVMInvalidateBlockFrequencies
+   after changing the CFG of Fun (NULL: every function). */
+uint64_t LLVMGetBlockFrequency(LLVMBasicBlockRef BB);
+void LLVMInvalidateBlockFrequencies(LLVMValueRef Fun);
+
+LLVM_C_EXTERN_C_END
+
+#endif
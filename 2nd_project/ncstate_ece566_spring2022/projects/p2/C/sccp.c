@@ -0,0 +1,395 @@
+/*
+ * File: sccp.c
+ *
+ * Description:
+ *   Sparse conditional constant propagation on top of the C worklist,
+ *   numbering and transform interfaces.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* LLVM Header Files */
+#include "llvm-c/Core.h"
+
+/* Header file global to this project */
+#include "dominance.h"
+#include "numbering.h"
+#include "profile.h"
+#include "sccp.h"
+#include "stats.h"
+#include "transform.h"
+#include "worklist.h"
+
+LLVMStatisticsRef SCCPConstants;
+LLVMStatisticsRef SCCPBranches;
+LLVMStatisticsRef SCCPSelects;
+LLVMStatisticsRef SCCPUnreachable;
+
+/* The lattice: a value with no entry is undefined so far (top), one
+   mapped to BOTTOM may vary, and anything else is the constant it maps
+   to. Values only ever move down. */
+static char bottom_marker;
+#define BOTTOM ((void *) &bottom_marker)
+
+typedef struct {
+    LLVMValueRef F;
+    LLVMNumberingRef N;
+    sidetable_t lattice;     /* instruction number -> lattice value */
+    sidetable_t executable;  /* block number -> worklist of executable predecessors */
+    worklist_t blocks;    /* blocks that just became executable */
+    worklist_t ssa;       /* instructions whose operands went down */
+} SCCP;
+
+static void *lattice_of(SCCP *s, LLVMValueRef V)
+{
+    if (LLVMIsAInstruction(V)) {
+        unsigned n = LLVMGetInstructionNumber(s->N, V);
+        return n == LLVM_NO_NUMBER ? BOTTOM : s->lattice[n];
+    }
+    /* Undef may be any value; treat it, and arguments, as varying. */
+    if (LLVMIsConstant(V) && !LLVMIsUndef(V))
+        return V;
+    return BOTTOM;
+}
+
+static void *meet(void *a, void *b)
+{
+    if (a == NULL)
+        return b;
+    if (b == NULL || a == b)
+        return a;
+    return BOTTOM;
+}
+
+static worklist_t *preds_of(SCCP *s, LLVMBasicBlockRef bb)
+{
+    return (worklist_t *) &s->executable[LLVMGetBlockNumber(s->N, bb)];
+}
+
+static int is_executable(SCCP *s, LLVMBasicBlockRef bb)
+{
+    return *preds_of(s, bb) != NULL;
+}
+
+static int is_edge_executable(SCCP *s, LLVMBasicBlockRef from, LLVMBasicBlockRef to)
+{
+    worklist_t preds = *preds_of(s, to);
+    return preds != NULL && worklist_contains(preds, LLVMBasicBlockAsValue(from));
+}
+
+static void mark_edge(SCCP *s, LLVMBasicBlockRef from, LLVMBasicBlockRef to)
+{
+    LLVMValueRef I;
+    worklist_t *slot = preds_of(s, to);
+    worklist_t preds = *slot;
+
+    if (preds == NULL) {
+        preds = *slot = worklist_create();
+        worklist_insert(s->blocks, LLVMBasicBlockAsValue(to));
+    } else if (from == NULL || worklist_contains(preds, LLVMBasicBlockAsValue(from))) {
+        return;
+    } else {
+        /* A new way into a block already visited: only its phis change. */
+        for (I = LLVMGetFirstInstruction(to); I != NULL && LLVMIsAPHINode(I);
+             I = LLVMGetNextInstruction(I))
+            worklist_insert(s->ssa, I);
+    }
+    if (from != NULL)
+        worklist_insert(preds, LLVMBasicBlockAsValue(from));
+}
+
+static void lower(SCCP *s, LLVMValueRef I, void *value)
+{
+    LLVMUseRef use;
+    void **slot = &s->lattice[LLVMGetInstructionNumber(s->N, I)];
+
+    if (value == NULL || value == *slot)
+        return;
+    *slot = value;
+    for (use = LLVMGetFirstUse(I); use != NULL; use = LLVMGetNextUse(use)) {
+        LLVMValueRef U = LLVMGetUser(use);
+        if (LLVMIsAInstruction(U) && is_executable(s, LLVMGetInstructionParent(U)))
+            worklist_insert(s->ssa, U);
+    }
+}
+
+/* The successors a terminator can take given its condition, or all of
+   them once the condition varies. */
+static void visit_terminator(SCCP *s, LLVMValueRef T)
+{
+    LLVMBasicBlockRef bb = LLVMGetInstructionParent(T);
+    unsigned i, n = LLVMGetNumSuccessors(T);
+    void *cond;
+
+    if (LLVMIsABranchInst(T) && LLVMIsConditional(T)) {
+        cond = lattice_of(s, LLVMGetCondition(T));
+        if (cond == NULL)
+            return;
+        if (cond != BOTTOM && LLVMIsAConstantInt(cond)) {
+            mark_edge(s, bb, LLVMGetSuccessor(T, LLVMConstIntGetZExtValue(cond) ? 0 : 1));
+            return;
+        }
+    } else if (LLVMIsASwitchInst(T)) {
+        cond = lattice_of(s, LLVMGetOperand(T, 0));
+        if (cond == NULL)
+            return;
+        if (cond != BOTTOM && LLVMIsAConstantInt(cond)) {
+            /* The operands are the condition, the default destination,
+               then value/destination pairs. */
+            for (i = 2; i < (unsigned) LLVMGetNumOperands(T); i += 2)
+                if (LLVMGetOperand(T, i) == cond) {
+                    mark_edge(s, bb, LLVMValueAsBasicBlock(LLVMGetOperand(T, i + 1)));
+                    return;
+                }
+            mark_edge(s, bb, LLVMGetSwitchDefaultDest(T));
+            return;
+        }
+    }
+
+    for (i = 0; i < n; i++)
+        mark_edge(s, bb, LLVMGetSuccessor(T, i));
+}
+
+static int is_foldable(LLVMValueRef I)
+{
+    switch (LLVMGetInstructionOpcode(I)) {
+    case LLVMFNeg:
+    case LLVMAdd: case LLVMFAdd: case LLVMSub: case LLVMFSub:
+    case LLVMMul: case LLVMFMul: case LLVMUDiv: case LLVMSDiv: case LLVMFDiv:
+    case LLVMURem: case LLVMSRem: case LLVMFRem:
+    case LLVMShl: case LLVMLShr: case LLVMAShr:
+    case LLVMAnd: case LLVMOr: case LLVMXor:
+    case LLVMTrunc: case LLVMZExt: case LLVMSExt:
+    case LLVMFPToUI: case LLVMFPToSI: case LLVMUIToFP: case LLVMSIToFP:
+    case LLVMFPTrunc: case LLVMFPExt: case LLVMPtrToInt: case LLVMIntToPtr:
+    case LLVMBitCast: case LLVMAddrSpaceCast:
+    case LLVMICmp: case LLVMFCmp: case LLVMSelect:
+    case LLVMGetElementPtr:
+    case LLVMExtractValue: case LLVMInsertValue:
+    case LLVMExtractElement: case LLVMInsertElement:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* A select on a known condition is the arm it picks, whatever the other
+   arm is; otherwise it is the meet of both, which is constant when both
+   arms are the same constant. */
+static void visit_select(SCCP *s, LLVMValueRef I)
+{
+    void *cond = lattice_of(s, LLVMGetOperand(I, 0));
+
+    if (cond == NULL)
+        return;
+    if (cond != BOTTOM && LLVMIsAConstantInt(cond)) {
+        lower(s, I, lattice_of(s, LLVMGetOperand(I, LLVMConstIntGetZExtValue(cond) ? 1 : 2)));
+        return;
+    }
+    lower(s, I, meet(lattice_of(s, LLVMGetOperand(I, 1)), lattice_of(s, LLVMGetOperand(I, 2))));
+}
+
+/* The arm a select that still varies always yields, or NULL: the lattice
+   holds constants only, so it cannot say a select is just %x. */
+static LLVMValueRef select_arm(SCCP *s, LLVMValueRef I)
+{
+    void *cond = lattice_of(s, LLVMGetOperand(I, 0));
+
+    if (cond != NULL && cond != BOTTOM && LLVMIsAConstantInt(cond))
+        return LLVMGetOperand(I, LLVMConstIntGetZExtValue(cond) ? 1 : 2);
+    if (LLVMGetOperand(I, 1) == LLVMGetOperand(I, 2))
+        return LLVMGetOperand(I, 1);
+    return NULL;
+}
+
+static void visit(SCCP *s, LLVMValueRef I)
+{
+    LLVMValueRef ops[8], *args, folded;
+    void *value;
+    int i, n;
+
+    if (LLVMIsATerminatorInst(I)) {
+        visit_terminator(s, I);
+        return;
+    }
+
+    if (LLVMIsAPHINode(I)) {
+        LLVMBasicBlockRef bb = LLVMGetInstructionParent(I);
+        value = NULL;
+        for (i = 0; i < (int) LLVMCountIncoming(I); i++)
+            if (is_edge_executable(s, LLVMGetIncomingBlock(I, i), bb))
+                value = meet(value, lattice_of(s, LLVMGetIncomingValue(I, i)));
+        lower(s, I, value);
+        return;
+    }
+
+    if (LLVMGetTypeKind(LLVMTypeOf(I)) == LLVMVoidTypeKind)
+        return;
+    if (LLVMIsASelectInst(I)) {
+        visit_select(s, I);
+        return;
+    }
+    if (!is_foldable(I)) {
+        lower(s, I, BOTTOM);
+        return;
+    }
+
+    n = LLVMGetNumOperands(I);
+    args = n <= 8 ? ops : malloc(sizeof(LLVMValueRef) * n);
+    value = NULL;
+    for (i = 0; i < n; i++) {
+        void *op = lattice_of(s, LLVMGetOperand(I, i));
+        if (op == BOTTOM) {
+            value = BOTTOM;
+            break;
+        }
+        if (op == NULL)
+            break;
+        args[i] = op;
+    }
+    if (i == n) {
+        /* Only plain constants go in the lattice; an expression that did
+           not fold down to one may vary as far as we can tell. */
+        folded = LLVMConstantFoldWithOperands(I, args);
+        value = folded != NULL && !LLVMIsAConstantExpr(folded) && !LLVMIsUndef(folded)
+            ? folded : BOTTOM;
+    }
+    if (args != ops)
+        free(args);
+    lower(s, I, value);
+}
+
+static void solve(SCCP *s)
+{
+    while (!worklist_empty(s->blocks) || !worklist_empty(s->ssa)) {
+        while (!worklist_empty(s->ssa))
+            visit(s, worklist_pop(s->ssa));
+        if (!worklist_empty(s->blocks)) {
+            LLVMBasicBlockRef bb = LLVMValueAsBasicBlock(worklist_pop(s->blocks));
+            LLVMValueRef I;
+            for (I = LLVMGetFirstInstruction(bb); I != NULL; I = LLVMGetNextInstruction(I))
+                visit(s, I);
+        }
+    }
+}
+
+/* A branch on a value still undefined at the fixpoint, such as one read
+   only on paths not taken yet, takes every successor. True if any did. */
+static int resolve_undefined_branches(SCCP *s)
+{
+    LLVMBasicBlockRef bb;
+    int changed = 0;
+
+    for (bb = LLVMGetFirstBasicBlock(s->F); bb != NULL; bb = LLVMGetNextBasicBlock(bb)) {
+        LLVMValueRef T = LLVMGetBasicBlockTerminator(bb);
+        unsigned i;
+        if (!is_executable(s, bb) || T == NULL)
+            continue;
+        if (!(LLVMIsABranchInst(T) && LLVMIsConditional(T)) && !LLVMIsASwitchInst(T))
+            continue;
+        /* LLVMGetCondition is for branches only; a switch's is operand 0 */
+        if (lattice_of(s, LLVMGetOperand(T, 0)) != NULL)
+            continue;
+        for (i = 0; i < LLVMGetNumSuccessors(T); i++)
+            if (!is_edge_executable(s, bb, LLVMGetSuccessor(T, i))) {
+                mark_edge(s, bb, LLVMGetSuccessor(T, i));
+                changed = 1;
+            }
+    }
+    return changed;
+}
+
+static void rewrite(SCCP *s)
+{
+    LLVMBasicBlockRef bb;
+    LLVMValueRef I, next;
+    unsigned removed;
+    int cfg_changed = 0;
+
+    for (bb = LLVMGetFirstBasicBlock(s->F); bb != NULL; bb = LLVMGetNextBasicBlock(bb)) {
+        if (!is_executable(s, bb))
+            continue;
+        for (I = LLVMGetFirstInstruction(bb); I != NULL; I = next) {
+            void *value = lattice_of(s, I);
+            next = LLVMGetNextInstruction(I);
+            if (value == BOTTOM && LLVMIsASelectInst(I)
+                && (value = select_arm(s, I)) != NULL) {
+                LLVMReplaceAllUsesWith(I, value);
+                LLVMInstructionEraseFromParent(I);
+                LLVMStatisticsInc(SCCPSelects);
+                continue;
+            }
+            if (value == NULL || value == BOTTOM)
+                continue;
+            LLVMReplaceAllUsesWith(I, value);
+            LLVMInstructionEraseFromParent(I);
+            LLVMStatisticsInc(SCCPConstants);
+        }
+        if (LLVMConstantFoldTerminator(bb)) {
+            LLVMStatisticsInc(SCCPBranches);
+            cfg_changed = 1;
+        }
+    }
+
+    removed = LLVMRemoveUnreachableBlocks(s->F);
+    if (removed > 0)
+        cfg_changed = 1;
+    while (removed-- > 0)
+        LLVMStatisticsInc(SCCPUnreachable);
+
+    /* Instructions were erased even when the CFG stayed put */
+    LLVMInvalidateNumbering(s->F);
+    if (cfg_changed) {
+        LLVMInvalidateDominators(s->F);
+        LLVMInvalidateBlockFrequencies(s->F);
+    }
+}
+
+static void sccp_function(SCCP *s)
+{
+    LLVMBasicBlockRef bb;
+
+    s->N = LLVMNumberFunction(s->F);
+    s->lattice = sidetable_create(LLVMNumberingInstructionCount(s->N));
+    s->executable = sidetable_create(LLVMNumberingBlockCount(s->N));
+    s->blocks = worklist_create();
+    s->ssa = worklist_create();
+
+    mark_edge(s, NULL, LLVMGetEntryBasicBlock(s->F));
+    do
+        solve(s);
+    while (resolve_undefined_branches(s));
+
+    /* The rewrite only asks whether a block is executable, and deletes
+       blocks, so drop the predecessor lists first. */
+    for (bb = LLVMGetFirstBasicBlock(s->F); bb != NULL; bb = LLVMGetNextBasicBlock(bb))
+        if (is_executable(s, bb))
+            worklist_destroy(*preds_of(s, bb));
+
+    rewrite(s);
+
+    worklist_destroy(s->ssa);
+    worklist_destroy(s->blocks);
+    sidetable_destroy(s->executable);
+    sidetable_destroy(s->lattice);
+}
+
+void SparseConditionalConstantPropagation(LLVMModuleRef Module)
+{
+    SCCP s;
+    SCCPConstants = LLVMStatisticsCreate("SCCPConstants", "SCCP instructions replaced by constants");
+    SCCPBranches = LLVMStatisticsCreate("SCCPBranches", "SCCP branches folded");
+    SCCPSelects = LLVMStatisticsCreate("SCCPSelects", "SCCP selects replaced by one arm");
+    SCCPUnreachable = LLVMStatisticsCreate("SCCPUnreachable", "SCCP unreachable blocks removed");
+
+    for (s.F = LLVMGetFirstFunction(Module); s.F != NULL; s.F = LLVMGetNextFunction(s.F)) {
+        size_t len;
+        if (LLVMCountBasicBlocks(s.F) == 0)
+            continue;
+
+        LLVMTimeTraceBegin("SCCP", LLVMGetValueName2(s.F, &len));
+        sccp_function(&s);
+        LLVMTimeTraceEnd();
+    }
+}
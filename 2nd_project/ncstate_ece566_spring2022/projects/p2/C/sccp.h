@@ -0,0 +1,28 @@
+#ifndef SCCP_H
+#define SCCP_H
+
+#include "llvm/Support/DataTypes.h"
+#include "llvm-c/Core.h"
+
+#ifdef __cplusplus
+
+/* Need these includes to support the LLVM 'cast' template for the C++ 'wrap' 
+   and 'unwrap' conversion functions. */
+#include "llvm/IR/Module.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/IR/IRBuilder.h"
+
+extern "C" {
+#endif
+
+/* Sparse conditional constant propagation (Wegman and Zadeck): replace
+   the values that are constant on every executable path with their
+   constants, fold branches on them and delete the blocks no path reaches
+   any more. */
+void SparseConditionalConstantPropagation(LLVMModuleRef Module);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,20 +2,170 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Value.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/TimeProfiler.h"
+
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
 
 #include "stats.h"
 
 using namespace llvm;
 
+namespace {
+/* A counter or histogram occupies Width consecutive slots: one for a
+   counter, one per power-of-two bucket plus the sum for a histogram. */
+struct Entry {
+    unsigned Slot;
+    unsigned Width;
+    std::string Name;
+    std::string Descr;
+    std::unique_ptr<TrackingStatistic> Stat;
+};
+
+/* The counts of one thread, by slot. Only the owning thread writes them,
+   so an increment is a plain add on memory no other thread touches;
+   LLVMStatisticsMerge reads them once the workers are done. */
+struct Shard {
+    std::vector<uint64_t> Counts;
+};
+
+/* Counters and histograms are looked up in separate maps, so that a
+   histogram never comes back for a counter of the same name, whose single
+   slot it would write past, or the other way round. */
+struct Registry {
+    std::mutex Lock;
+    StringMap<std::unique_ptr<Entry>> Counters;
+    StringMap<std::unique_ptr<Entry>> HistogramsByName;
+    std::vector<Entry*> Histograms;
+    std::vector<std::unique_ptr<Shard>> Shards;
+    std::vector<uint64_t> Totals;
+    unsigned Slots = 0;
+};
+}
+
+/* Never destroyed, so that threads and exit-time reports can still use it. */
+static Registry &registry()
+{
+    static Registry *R = new Registry();
+    return *R;
+}
+
+static const unsigned HistogramBuckets = 65;
+
+static Entry *lookup(const char *name, const char *descr, unsigned width)
+{
+    Registry &R = registry();
+    std::lock_guard<std::mutex> Lock(R.Lock);
+    std::unique_ptr<Entry> &E = (width == 1 ? R.Counters : R.HistogramsByName)[name];
+    if (E == NULL) {
+        E.reset(new Entry());
+        E->Slot = R.Slots;
+        E->Width = width;
+        E->Name = name;
+        E->Descr = descr;
+        R.Slots += width;
+        R.Totals.resize(R.Slots);
+        if (width == 1)
+            E->Stat.reset(new TrackingStatistic("", E->Name.c_str(), E->Descr.c_str()));
+        else
+            R.Histograms.push_back(E.get());
+    }
+    return E.get();
+}
+
+/* The calling thread's counts, grown to cover slot. */
+static uint64_t *shard(unsigned slot)
+{
+    static thread_local Shard *S = NULL;
+    if (S == NULL || slot >= S->Counts.size()) {
+        Registry &R = registry();
+        std::lock_guard<std::mutex> Lock(R.Lock);
+        if (S == NULL) {
+            R.Shards.emplace_back(new Shard());
+            S = R.Shards.back().get();
+        }
+        S->Counts.resize(R.Slots);
+    }
+    return S->Counts.data();
+}
+
 LLVMStatisticsRef LLVMStatisticsCreate(const char* name, const char * descr)
 {
-    Statistic *s = new llvm::Statistic("", name, descr);
-    return (LLVMStatisticsRef) s;
+    return (LLVMStatisticsRef) lookup(name, descr, 1);
 }
 
 void LLVMStatisticsInc(LLVMStatisticsRef s)
 {
-    Statistic *ref = (Statistic*) s;
-    (*ref)++;
+    Entry *E = (Entry*) s;
+    shard(E->Slot)[E->Slot]++;
+}
+
+LLVMHistogramRef LLVMHistogramCreate(const char *name, const char *descr)
+{
+    return (LLVMHistogramRef) lookup(name, descr, HistogramBuckets + 1);
 }
 
+void LLVMHistogramAdd(LLVMHistogramRef h, uint64_t value)
+{
+    Entry *E = (Entry*) h;
+    unsigned bucket = value == 0 ? 0 : 64 - countLeadingZeros(value);
+    uint64_t *Counts = shard(E->Slot + HistogramBuckets);
+    Counts[E->Slot + bucket]++;
+    Counts[E->Slot + HistogramBuckets] += value;
+}
+
+void LLVMStatisticsMerge(void)
+{
+    Registry &R = registry();
+    std::lock_guard<std::mutex> Lock(R.Lock);
+    for (auto &S : R.Shards)
+        for (unsigned i = 0; i < S->Counts.size(); i++) {
+            R.Totals[i] += S->Counts[i];
+            S->Counts[i] = 0;
+        }
+
+    /* Counters go on to the llvm::Statistic of the same name, so that they
+       appear in -verbose and the .stats file. */
+    for (auto &E : R.Counters) {
+        uint64_t &Total = R.Totals[E.second->Slot];
+        *E.second->Stat += Total;
+        Total = 0;
+    }
+}
+
+void LLVMHistogramsPrint(std::ostream &OS)
+{
+    Registry &R = registry();
+    std::lock_guard<std::mutex> Lock(R.Lock);
+    for (Entry *E : R.Histograms) {
+        uint64_t Count = 0;
+        for (unsigned b = 0; b < HistogramBuckets; b++)
+            Count += R.Totals[E->Slot + b];
+        if (Count == 0)
+            continue;
+
+        OS << E->Name << ".Count," << Count << std::endl;
+        OS << E->Name << ".Sum," << R.Totals[E->Slot + HistogramBuckets] << std::endl;
+        for (unsigned b = 0; b < HistogramBuckets; b++)
+            if (R.Totals[E->Slot + b] != 0)
+                OS << E->Name << ".Ge" << (b == 0 ? 0 : uint64_t(1) << (b - 1)) << ","
+                   << R.Totals[E->Slot + b] << std::endl;
+    }
+}
+
+void LLVMTimeTraceBegin(const char *name, const char *detail)
+{
+    if (timeTraceProfilerEnabled())
+        timeTraceProfilerBegin(name, detail);
+}
+
+void LLVMTimeTraceEnd(void)
+{
+    if (timeTraceProfilerEnabled())
+        timeTraceProfilerEnd();
+}
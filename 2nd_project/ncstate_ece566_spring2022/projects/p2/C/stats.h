@@ -9,10 +9,37 @@
 LLVM_C_EXTERN_C_BEGIN
 
 typedef struct LLVMStatisticsOpaque *LLVMStatisticsRef;
+typedef struct LLVMHistogramOpaque *LLVMHistogramRef;
 
+/* Counters and histograms are registered by name: creating one again
+   returns the same handle, and a counter and a histogram of the same name
+   are distinct. Increments go to a per-thread shard and are safe from
+   worker threads without locking; LLVMStatisticsMerge adds the shards up
+   and must run once the workers are done, before the statistics are
+   printed. */
 LLVMStatisticsRef LLVMStatisticsCreate(const char* name, const char * descr);
 void LLVMStatisticsInc(LLVMStatisticsRef s);
 
+/* A histogram counts values, such as eliminations per function, in
+   power-of-two buckets, and keeps their sum. */
+LLVMHistogramRef LLVMHistogramCreate(const char *name, const char *descr);
+void LLVMHistogramAdd(LLVMHistogramRef h, uint64_t value);
+
+void LLVMStatisticsMerge(void);
+
+/* Open and close a span in the -trace output, e.g. around the work on one
+   function. Spans nest; they do nothing when -trace is not given. */
+void LLVMTimeTraceBegin(const char *name, const char *detail);
+void LLVMTimeTraceEnd(void);
+
 LLVM_C_EXTERN_C_END
 
+#ifdef __cplusplus
+#include <ostream>
+
+/* Write the merged histograms as .stats rows: <name>.Count, <name>.Sum and
+   <name>.Ge<lower bound> for every bucket in use. */
+void LLVMHistogramsPrint(std::ostream &OS);
+#endif
+
 #endif
\ No newline at end of file
@@ -7,157 +7,387 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
 
 /* LLVM Header Files */
 #include "llvm-c/Core.h"
-#include "dominance.h"
-#include "valmap.h"
 
 /* Header file global to this project */
 #include "summary.h"
 
-typedef struct Stats_def {
-  int functions;
-  int globals;
-  int bbs;
-
-  int insns;
-  int insns_nearby_dep;
-  
-  int allocas;
-
-  int loads;
-  int loads_alloca;
-  int loads_globals;
-
-  int stores;
-  int stores_alloca;
-  int stores_globals;
-  
-  int conditional_branches;
-  int calls;
-
-  int gep;
-  int gep_load;
-  int gep_alloca;
-  int gep_globals;
-  int gep_gep;
-
-  int loops; //approximated by backedges
-  int floats;
-} Stats;
-
-void pretty_print_stats(FILE *f, Stats s, int spaces)
+/* An instruction is a nearby dependence if one of its operands is defined
+   at most this many instructions earlier in the same basic block. */
+#define NEARBY_DISTANCE 3
+
+/* Every counter of Stats, in report order, with its CSV/JSON key and its
+   label in the pretty print. */
+static const struct {
+  const char *key;
+  const char *label;
+  size_t offset;
+} Fields[] = {
+  { "functions",        "Functions.......................", offsetof(Stats, functions) },
+  { "globals",          "Global Vars.....................", offsetof(Stats, globals) },
+  { "bbs",              "Basic Blocks....................", offsetof(Stats, bbs) },
+  { "insns",            "Instructions....................", offsetof(Stats, insns) },
+  { "insns_nearby_dep", "Instructions - Nearby Dep.......", offsetof(Stats, insns_nearby_dep) },
+  { "branches",         "Instructions - Cond. Branches...", offsetof(Stats, conditional_branches) },
+  { "calls",            "Instructions - Calls............", offsetof(Stats, calls) },
+  { "allocas",          "Instructions - Allocas..........", offsetof(Stats, allocas) },
+  { "loads",            "Instructions - Loads............", offsetof(Stats, loads) },
+  { "loads_alloca",     "Instructions - Loads (alloca)...", offsetof(Stats, loads_alloca) },
+  { "loads_globals",    "Instructions - Loads (globals)..", offsetof(Stats, loads_globals) },
+  { "stores",           "Instructions - Stores...........", offsetof(Stats, stores) },
+  { "stores_alloca",    "Instructions - Stores (alloca)..", offsetof(Stats, stores_alloca) },
+  { "stores_global",    "Instructions - Stores (globals).", offsetof(Stats, stores_globals) },
+  { "gep",              "Instructions - gep..............", offsetof(Stats, gep) },
+  { "gep_load",         "Instructions - gep (load).......", offsetof(Stats, gep_load) },
+  { "gep_alloca",       "Instructions - gep (alloca).....", offsetof(Stats, gep_alloca) },
+  { "gep_globals",      "Instructions - gep (globals)....", offsetof(Stats, gep_globals) },
+  { "gep_gep",          "Instructions - gep (gep)........", offsetof(Stats, gep_gep) },
+  { "loops",            "Loops...........................", offsetof(Stats, loops) },
+  { "floats",           "Floats..........................", offsetof(Stats, floats) },
+};
+
+#define NUM_FIELDS (sizeof(Fields) / sizeof(Fields[0]))
+
+static int *field(Stats *s, unsigned i)
+{
+  return (int *) ((char *) s + Fields[i].offset);
+}
+
+static void add_stats(Stats *into, Stats *s)
 {
-  char spc[128];
-  int i;
-
-  // insert spaces before each line
-  for(i=0; i<spaces; i++)
-    spc[i] = ' ';
-  spc[i] = '\0';
-    
-  fprintf(f,"%sFunctions.......................%d\n",spc,s.functions);
-  //fprintf(f,"%sGlobal Vars.....................%d\n",spc,s.globals);
-  fprintf(f,"%sBasic Blocks....................%d\n",spc,s.bbs);
-  fprintf(f,"%sInstructions....................%d\n",spc,s.insns);
-  //fprintf(f,"%sInstructions - Nearby Dep.......%d\n",spc,s.insns_nearby_dep);
-
-  /* fprintf(f,"%sInstructions - Cond. Branches...%d\n",spc,s.conditional_branches); */
-  /* fprintf(f,"%sInstructions - Calls............%d\n",spc,s.calls); */
-
-  /* fprintf(f,"%sInstructions - Allocas..........%d\n",spc,s.allocas); */
-  fprintf(f,"%sInstructions - Loads............%d\n",spc,s.loads);
-  /* fprintf(f,"%sInstructions - Loads (alloca)...%d\n",spc,s.loads_alloca); */
-  /* fprintf(f,"%sInstructions - Loads (globals)..%d\n",spc,s.loads_globals); */
-
-
-  fprintf(f,"%sInstructions - Stores...........%d\n",spc,s.stores);
-  /* fprintf(f,"%sInstructions - Stores (alloca)..%d\n",spc,s.stores_alloca); */
-  /* fprintf(f,"%sInstructions - Stores (globals).%d\n",spc,s.stores_globals); */
-
-
-  /* fprintf(f,"%sInstructions - gep..............%d\n",spc,s.gep); */
-  /* fprintf(f,"%sInstructions - gep (load).......%d\n",spc,s.gep_load); */
-  /* fprintf(f,"%sInstructions - gep (alloca).....%d\n",spc,s.gep_alloca); */
-  /* fprintf(f,"%sInstructions - gep (globals)....%d\n",spc,s.gep_globals); */
-  /* fprintf(f,"%sInstructions - gep (gep)........%d\n",spc,s.gep_gep); */
-
-  /* fprintf(f,"%sInstructions - Other............%d\n",spc, */
-  /* 	  s.insns-s.conditional_branches-s.loads-s.stores-s.gep-s.calls); */
-  /* fprintf(f,"%sLoops...........................%d\n",spc,s.loops); */
-  /* fprintf(f,"%sFloats..........................%d\n",spc,s.floats); */
+  unsigned i;
+  for (i = 0; i < NUM_FIELDS; i++)
+    *field(into, i) += *field(s, i);
+}
+
+void summary_pretty_print(FILE *f, Stats s, int spaces)
+{
+  unsigned i;
+  int other;
+
+  for (i = 0; i < NUM_FIELDS; i++)
+    {
+      fprintf(f,"%*s%s%d\n",spaces,"",Fields[i].label,*field(&s,i));
+      if (Fields[i].offset == offsetof(Stats, gep_gep))
+	{
+	  other = s.insns-s.conditional_branches-s.loads-s.stores-s.gep-s.calls;
+	  fprintf(f,"%*sInstructions - Other............%d\n",spaces,"",other);
+	}
+    }
 }
 
-void print_csv_file(const char *filename, Stats s, const char *id)
+void summary_print_csv(const char *filename, Stats s, const char *id)
 {
+  unsigned i;
   FILE *f = fopen(filename,"w");
+  if (f == NULL)
+    {
+      perror(filename);
+      return;
+    }
   fprintf(f,"id,%s\n",id);
-  fprintf(f,"functions,%d\n",s.functions);
-  //fprintf(f,"globals,%d\n",s.globals);
-  fprintf(f,"bbs,%d\n",s.bbs);
-  fprintf(f,"insns,%d\n",s.insns);
-  //fprintf(f,"insns_nearby_dep,%d\n",s.insns_nearby_dep);
-  //fprintf(f,"allocas,%d\n",s.allocas);
-  //fprintf(f,"branches,%d\n",s.conditional_branches);
-  //fprintf(f,"calls,%d\n",s.calls);
-  fprintf(f,"loads,%d\n",s.loads);
-  //fprintf(f,"loads_alloca,%d\n",s.loads_alloca);
-  //fprintf(f,"loads_globals,%d\n",s.loads_globals);
-  fprintf(f,"stores,%d\n",s.stores);
-  //fprintf(f,"stores_alloca,%d\n",s.stores_alloca);
-  //fprintf(f,"stores_global,%d\n",s.stores_globals);
-  //fprintf(f,"loops,%d\n",s.loops);
-  //fprintf(f,"floats,%d\n",s.floats);
+  for (i = 0; i < NUM_FIELDS; i++)
+    fprintf(f,"%s,%d\n",Fields[i].key,*field(&s,i));
   fclose(f);
 }
 
-Stats MyStats;
+void summary_print_json(const char *filename, Stats s, const char *id)
+{
+  unsigned i;
+  const char *c;
+  FILE *f = fopen(filename,"w");
+  if (f == NULL)
+    {
+      perror(filename);
+      return;
+    }
+  fprintf(f,"{\n  \"id\": \"");
+  for (c = id; *c; c++)
+    {
+      if (*c == '"' || *c == '\\')
+	fputc('\\',f);
+      fputc(*c,f);
+    }
+  fprintf(f,"\"");
+  for (i = 0; i < NUM_FIELDS; i++)
+    fprintf(f,",\n  \"%s\": %d",Fields[i].key,*field(&s,i));
+  fprintf(f,"\n}\n");
+  fclose(f);
+}
 
-void
-Summarize(LLVMModuleRef Module, const char *id, const char* filename)
+static int is_float_type(LLVMTypeRef T)
 {
-  LLVMValueRef  fn_iter; // iterator 
-  for (fn_iter = LLVMGetFirstFunction(Module); fn_iter!=NULL; 
-       fn_iter = LLVMGetNextFunction(fn_iter))
+  switch (LLVMGetTypeKind(T))
     {
-      if (LLVMGetFirstBasicBlock(fn_iter) != NULL)
+    case LLVMHalfTypeKind:
+    case LLVMBFloatTypeKind:
+    case LLVMFloatTypeKind:
+    case LLVMDoubleTypeKind:
+    case LLVMX86_FP80TypeKind:
+    case LLVMFP128TypeKind:
+    case LLVMPPC_FP128TypeKind:
+      return 1;
+    case LLVMVectorTypeKind:
+    case LLVMScalableVectorTypeKind:
+      return is_float_type(LLVMGetElementType(T));
+    default:
+      return 0;
+    }
+}
+
+/* Blocks sorted by address, so that a block's number is its position
+   found with bsearch. */
+static int compare_blocks(const void *a, const void *b)
+{
+  LLVMBasicBlockRef x = *(const LLVMBasicBlockRef *) a;
+  LLVMBasicBlockRef y = *(const LLVMBasicBlockRef *) b;
+  return x < y ? -1 : x > y;
+}
+
+static unsigned block_number(LLVMBasicBlockRef *sorted, unsigned nblocks,
+			     LLVMBasicBlockRef bb)
+{
+  LLVMBasicBlockRef *found = bsearch(&bb, sorted, nblocks,
+				     sizeof(LLVMBasicBlockRef), compare_blocks);
+  return found - sorted;
+}
+
+/* Count the retreating edges of a depth-first walk of the CFG of Fn, each
+   of which closes a loop. This runs on the worker threads, so the DFS
+   state lives in plain arrays: a valmap_t registers value handles in the
+   shared LLVMContext, which is not thread-safe. */
+static int count_backedges(LLVMValueRef Fn)
+{
+  unsigned nblocks = LLVMCountBasicBlocks(Fn);
+  LLVMBasicBlockRef *sorted = malloc(sizeof(LLVMBasicBlockRef) * nblocks);
+  LLVMBasicBlockRef *stack = malloc(sizeof(LLVMBasicBlockRef) * nblocks);
+  unsigned *next = malloc(sizeof(unsigned) * nblocks);
+  char *state = calloc(nblocks, 1);  /* 1: on the stack, 2: finished */
+  LLVMBasicBlockRef iter;
+  int backedges = 0;
+  unsigned depth = 0, i = 0;
+
+  for (iter = LLVMGetFirstBasicBlock(Fn); iter != NULL;
+       iter = LLVMGetNextBasicBlock(iter))
+    sorted[i++] = iter;
+  qsort(sorted, nblocks, sizeof(LLVMBasicBlockRef), compare_blocks);
+
+  stack[depth] = LLVMGetEntryBasicBlock(Fn);
+  next[depth++] = 0;
+  state[block_number(sorted, nblocks, stack[0])] = 1;
+
+  while (depth > 0)
+    {
+      LLVMBasicBlockRef bb = stack[depth-1];
+      LLVMValueRef term = LLVMGetBasicBlockTerminator(bb);
+      if (term == NULL || next[depth-1] == LLVMGetNumSuccessors(term))
 	{
-	  MyStats.functions++;
+	  state[block_number(sorted, nblocks, bb)] = 2;
+	  depth--;
+	  continue;
 	}
-      
-      // fn_iter points to a function
-      LLVMBasicBlockRef bb_iter; /* points to each basic block
-				    one at a time */
-      for (bb_iter = LLVMGetFirstBasicBlock(fn_iter);
-	   bb_iter != NULL; bb_iter = LLVMGetNextBasicBlock(bb_iter))
+
+      LLVMBasicBlockRef succ = LLVMGetSuccessor(term, next[depth-1]++);
+      unsigned n = block_number(sorted, nblocks, succ);
+      if (state[n] == 1)
+	backedges++;
+      else if (state[n] == 0)
 	{
-	  MyStats.bbs++;
-	  
-	  LLVMValueRef inst_iter; /* points to each instruction */
-	  for(inst_iter = LLVMGetFirstInstruction(bb_iter);
-	      inst_iter != NULL; 
-	      inst_iter = LLVMGetNextInstruction(inst_iter)) 
+	  state[n] = 1;
+	  stack[depth] = succ;
+	  next[depth++] = 0;
+	}
+    }
+
+  free(state);
+  free(next);
+  free(stack);
+  free(sorted);
+  return backedges;
+}
+
+/* What an address or GEP base is, for the load/store/gep breakdowns. */
+static void count_base(LLVMValueRef base, int *alloca, int *global,
+		       int *load, int *gep)
+{
+  if (LLVMIsAAllocaInst(base))
+    (*alloca)++;
+  else if (LLVMIsAGlobalVariable(base))
+    (*global)++;
+  else if (load && LLVMIsALoadInst(base))
+    (*load)++;
+  else if (gep && LLVMIsAGetElementPtrInst(base))
+    (*gep)++;
+}
+
+static void summarize_function(LLVMValueRef Fn, Stats *s)
+{
+  LLVMBasicBlockRef bb_iter;
+  LLVMValueRef recent[NEARBY_DISTANCE];
+
+  s->functions++;
+  s->loops += count_backedges(Fn);
+
+  for (bb_iter = LLVMGetFirstBasicBlock(Fn);
+       bb_iter != NULL; bb_iter = LLVMGetNextBasicBlock(bb_iter))
+    {
+      LLVMValueRef inst_iter;
+      unsigned pos = 0;
+
+      s->bbs++;
+      memset(recent, 0, sizeof(recent));
+
+      for (inst_iter = LLVMGetFirstInstruction(bb_iter);
+	   inst_iter != NULL;
+	   inst_iter = LLVMGetNextInstruction(inst_iter), pos++)
+	{
+	  int i, j, nops = LLVMGetNumOperands(inst_iter);
+	  int nearby = 0;
+
+	  s->insns++;
+
+	  /* recent holds the last NEARBY_DISTANCE instructions of the block */
+	  for (i = 0; i < nops && !nearby; i++)
 	    {
-	      MyStats.insns++;
-	      
-	      // get the basic block of this instruction
-	      LLVMBasicBlockRef ref = 
-		LLVMGetInstructionParent(inst_iter);
-
-	      if ( LLVMIsALoadInst(inst_iter) ) {
-		MyStats.loads++;
-	      } else if ( LLVMIsAStoreInst(inst_iter)) {
-		MyStats.stores++;
-	      }
+	      LLVMValueRef op = LLVMGetOperand(inst_iter, i);
+	      for (j = 0; j < NEARBY_DISTANCE; j++)
+		if (recent[j] != NULL && recent[j] == op)
+		  nearby = 1;
+	    }
+	  s->insns_nearby_dep += nearby;
+	  recent[pos % NEARBY_DISTANCE] = inst_iter;
+
+	  if (is_float_type(LLVMTypeOf(inst_iter)))
+	    s->floats++;
 
+	  switch (LLVMGetInstructionOpcode(inst_iter))
+	    {
+	    case LLVMAlloca:
+	      s->allocas++;
+	      break;
+	    case LLVMLoad:
+	      s->loads++;
+	      count_base(LLVMGetOperand(inst_iter,0), &s->loads_alloca,
+			 &s->loads_globals, NULL, NULL);
+	      break;
+	    case LLVMStore:
+	      s->stores++;
+	      count_base(LLVMGetOperand(inst_iter,1), &s->stores_alloca,
+			 &s->stores_globals, NULL, NULL);
+	      break;
+	    case LLVMGetElementPtr:
+	      s->gep++;
+	      count_base(LLVMGetOperand(inst_iter,0), &s->gep_alloca,
+			 &s->gep_globals, &s->gep_load, &s->gep_gep);
+	      break;
+	    case LLVMBr:
+	      if (LLVMIsConditional(inst_iter))
+		s->conditional_branches++;
+	      break;
+	    case LLVMCall:
+	      s->calls++;
+	      break;
+	    default:
+	      break;
 	    }
 	}
     }
+}
+
+typedef struct {
+  LLVMValueRef *functions;
+  unsigned count;
+  unsigned first;
+  unsigned stride;
+  pthread_t thread;
+  int running;
+  Stats stats;
+} Shard;
+
+static void *summarize_shard(void *arg)
+{
+  Shard *shard = arg;
+  unsigned i;
+  for (i = shard->first; i < shard->count; i += shard->stride)
+    summarize_function(shard->functions[i], &shard->stats);
+  return NULL;
+}
+
+void SummarizeModule(LLVMModuleRef Module, Stats *s, unsigned jobs)
+{
+  LLVMValueRef fn_iter;
+  LLVMValueRef *functions;
+  Shard *shards;
+  unsigned count = 0, i;
+
+  memset(s, 0, sizeof(*s));
+
+  for (fn_iter = LLVMGetFirstGlobal(Module); fn_iter != NULL;
+       fn_iter = LLVMGetNextGlobal(fn_iter))
+    s->globals++;
+
+  for (fn_iter = LLVMGetFirstFunction(Module); fn_iter != NULL;
+       fn_iter = LLVMGetNextFunction(fn_iter))
+    count++;
+  functions = malloc(sizeof(LLVMValueRef) * (count + 1));
+  count = 0;
+  for (fn_iter = LLVMGetFirstFunction(Module); fn_iter != NULL;
+       fn_iter = LLVMGetNextFunction(fn_iter))
+    if (LLVMGetFirstBasicBlock(fn_iter) != NULL)
+      functions[count++] = fn_iter;
+
+  if (jobs == 0)
+    jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  if (jobs > count)
+    jobs = count;
+  if (jobs == 0)
+    jobs = 1;
+
+  shards = calloc(jobs, sizeof(Shard));
+  for (i = 0; i < jobs; i++)
+    {
+      shards[i].functions = functions;
+      shards[i].count = count;
+      shards[i].first = i;
+      shards[i].stride = jobs;
+    }
 
+  /* The calling thread takes the first shard, and any shard that could
+     not get a thread of its own. */
+  for (i = 1; i < jobs; i++)
+    shards[i].running = pthread_create(&shards[i].thread, NULL,
+				       summarize_shard, &shards[i]) == 0;
+  for (i = 0; i < jobs; i++)
+    if (!shards[i].running)
+      summarize_shard(&shards[i]);
+  for (i = 1; i < jobs; i++)
+    if (shards[i].running)
+      pthread_join(shards[i].thread, NULL);
 
-  pretty_print_stats(stdout,MyStats,0);
-  print_csv_file(filename,MyStats,id);
+  for (i = 0; i < jobs; i++)
+    add_stats(s, &shards[i].stats);
+
+  free(shards);
+  free(functions);
 }
 
+void
+Summarize(LLVMModuleRef Module, const char *id, const char* filename)
+{
+  Stats s;
+  char *json = malloc(strlen(filename) + sizeof(".json"));
+
+  SummarizeModule(Module, &s, 0);
+
+  summary_pretty_print(stdout,s,0);
+  summary_print_csv(filename,s,id);
+  sprintf(json,"%s.json",filename);
+  summary_print_json(json,s,id);
+  free(json);
+}
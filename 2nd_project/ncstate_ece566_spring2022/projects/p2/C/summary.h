@@ -12,13 +12,54 @@
 #include "llvm/IR/Value.h"
 #include "llvm/IR/Module.h"
 
-void Summarize_Cpp(llvm::Module *M, const char *id, const char *filename);
-
 extern "C" {
 #endif
 
+#include <stdio.h>
 #include "llvm-c/Core.h"
 
+typedef struct Stats_def {
+  int functions;
+  int globals;
+  int bbs;
+
+  int insns;
+  int insns_nearby_dep;
+  
+  int allocas;
+
+  int loads;
+  int loads_alloca;
+  int loads_globals;
+
+  int stores;
+  int stores_alloca;
+  int stores_globals;
+  
+  int conditional_branches;
+  int calls;
+
+  int gep;
+  int gep_load;
+  int gep_alloca;
+  int gep_globals;
+  int gep_gep;
+
+  int loops; //approximated by backedges
+  int floats;
+} Stats;
+
+/* Fill in s, which is cleared first, for every function with a body in
+   Module, in one pass over each function. Functions are split round-robin
+   across jobs threads (0: one per core); the module is only read. */
+void SummarizeModule(LLVMModuleRef Module, Stats *s, unsigned jobs);
+
+void summary_pretty_print(FILE *f, Stats s, int spaces);
+void summary_print_csv(const char *filename, Stats s, const char *id);
+void summary_print_json(const char *filename, Stats s, const char *id);
+
+/* Summarize Module on every core, print it to stdout and write it to
+   filename as CSV and to filename.json. */
 void Summarize(LLVMModuleRef Module, const char *id, const char *filename);
 
 #ifdef __cplusplus
@@ -0,0 +1,263 @@
+/*
+ * File: apitest.c
+ *
+ * Description:
+ *   Prints what the C interfaces answer for each function of a module, so
+ *   that FileCheck can test them:
+ *
+ *     apitest frontiers <input.ll> <output.txt>
+ *     apitest cfg <input.ll> <output.txt>
+ *     apitest worklist <input.ll> <output.txt>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* LLVM Header Files */
+#include "llvm-c/Core.h"
+#include "llvm-c/IRReader.h"
+
+/* Header file global to this project */
+#include "cfg.h"
+#include "dominance.h"
+#include "worklist.h"
+
+static FILE *out;
+
+static void print_block(LLVMBasicBlockRef bb)
+{
+    fprintf(out, " %s", LLVMGetBasicBlockName(bb));
+}
+
+/* Print the Count blocks of an array in its order, which keeps one entry
+   per edge, and free it. */
+static void print_array(const char *what, const char *of, LLVMBasicBlockRef *blocks,
+                        unsigned count)
+{
+    unsigned i;
+
+    fprintf(out, "%s(%s) =", what, of);
+    for (i = 0; i < count; i++)
+        print_block(blocks[i]);
+    fprintf(out, "\n");
+    free(blocks);
+}
+
+/* Print the blocks of set in layout order, so the output does not depend
+   on the order the set was built in, and destroy it. */
+static void print_set(LLVMValueRef F, const char *what, const char *of, worklist_t set)
+{
+    LLVMBasicBlockRef bb;
+    unsigned printed = 0;
+
+    fprintf(out, "%s(%s) =", what, of);
+    for (bb = LLVMGetFirstBasicBlock(F); bb != NULL; bb = LLVMGetNextBasicBlock(bb))
+        if (worklist_contains(set, LLVMBasicBlockAsValue(bb))) {
+            print_block(bb);
+            printed++;
+        }
+    while (!worklist_empty(set)) {
+        worklist_pop(set);
+        if (printed-- == 0)
+            fprintf(out, " <not a block of %s>", LLVMGetValueName(F));
+    }
+    fprintf(out, "\n");
+    worklist_destroy(set);
+}
+
+/* The frontiers of every block, then the iterated frontiers of the blocks
+   that store to each alloca, where mem2reg would put its phis. */
+static void frontiers(LLVMValueRef F)
+{
+    LLVMBasicBlockRef bb;
+    LLVMValueRef I;
+
+    for (bb = LLVMGetFirstBasicBlock(F); bb != NULL; bb = LLVMGetNextBasicBlock(bb)) {
+        const char *name = LLVMGetBasicBlockName(bb);
+        print_set(F, "DF", name, LLVMDominanceFrontierLocal(bb));
+        print_set(F, "DF+", name, LLVMDominanceFrontierClosure(bb));
+        print_set(F, "PDF", name, LLVMPostDominanceFrontierLocal(bb));
+        print_set(F, "PDF+", name, LLVMPostDominanceFrontierClosure(bb));
+    }
+
+    for (I = LLVMGetFirstInstruction(LLVMGetEntryBasicBlock(F)); I != NULL;
+         I = LLVMGetNextInstruction(I)) {
+        unsigned n = 0;
+        LLVMBasicBlockRef *defs;
+        LLVMUseRef use;
+
+        if (!LLVMIsAAllocaInst(I))
+            continue;
+        for (use = LLVMGetFirstUse(I); use != NULL; use = LLVMGetNextUse(use))
+            n++;
+        defs = malloc(sizeof(LLVMBasicBlockRef) * (n + 1));
+        n = 0;
+        for (use = LLVMGetFirstUse(I); use != NULL; use = LLVMGetNextUse(use)) {
+            LLVMValueRef U = LLVMGetUser(use);
+            if (LLVMIsAStoreInst(U) && LLVMGetOperand(U, 1) == I)
+                defs[n++] = LLVMGetInstructionParent(U);
+        }
+        print_set(F, "IDF", LLVMGetValueName(I), LLVMIteratedDominanceFrontier(F, defs, n));
+        print_set(F, "IPDF", LLVMGetValueName(I), LLVMIteratedPostDominanceFrontier(F, defs, n));
+        free(defs);
+    }
+}
+
+/* The successors, predecessors and dominator-tree children of every
+   block, as the bulk interfaces return them. */
+static void cfg(LLVMValueRef F)
+{
+    LLVMBasicBlockRef bb, *blocks;
+    unsigned n;
+
+    for (bb = LLVMGetFirstBasicBlock(F); bb != NULL; bb = LLVMGetNextBasicBlock(bb)) {
+        const char *name = LLVMGetBasicBlockName(bb);
+
+        n = LLVMCountSuccessors(bb);
+        blocks = malloc(sizeof(LLVMBasicBlockRef) * (n + 1));
+        LLVMGetSuccessors(bb, blocks);
+        print_array("succs", name, blocks, n);
+
+        n = LLVMCountPredecessors(bb);
+        blocks = malloc(sizeof(LLVMBasicBlockRef) * (n + 1));
+        LLVMGetPredecessors(bb, blocks);
+        print_array("preds", name, blocks, n);
+
+        n = LLVMCountDomChildren(bb);
+        blocks = malloc(sizeof(LLVMBasicBlockRef) * (n + 1));
+        LLVMGetDomChildren(bb, blocks);
+        print_array("domchildren", name, blocks, n);
+    }
+}
+
+static void print_value(LLVMValueRef V)
+{
+    if (LLVMValueIsBasicBlock(V))
+        print_block(LLVMValueAsBasicBlock(V));
+    else if (LLVMIsAConstantInt(V))
+        fprintf(out, " %lld", LLVMConstIntGetSExtValue(V));
+    else
+        fprintf(out, " %s", LLVMGetValueName(V));
+}
+
+/* Pop w dry, printing the values in the order they leave, and destroy
+   it. */
+static void print_pops(const char *what, worklist_t w)
+{
+    fprintf(out, "%s =", what);
+    while (!worklist_empty(w)) {
+        LLVMValueRef top = worklist_top(w);
+        LLVMValueRef V = worklist_pop(w);
+        if (V != top)
+            fprintf(out, " <top was not popped>");
+        print_value(V);
+    }
+    fprintf(out, "\n");
+    worklist_destroy(w);
+}
+
+/* Insert the blocks of F in layout order, and the first one again, which
+   is still waiting and so stays put; pop one and insert it again, which
+   queues it anew; then pop the rest. */
+static void block_pops(LLVMValueRef F, const char *what, worklist_order_t order)
+{
+    worklist_t w = worklist_create_ordered(order, F);
+    LLVMBasicBlockRef bb;
+
+    for (bb = LLVMGetFirstBasicBlock(F); bb != NULL; bb = LLVMGetNextBasicBlock(bb))
+        worklist_insert(w, LLVMBasicBlockAsValue(bb));
+    worklist_insert(w, LLVMBasicBlockAsValue(LLVMGetFirstBasicBlock(F)));
+    fprintf(out, "%s first =", what);
+    print_value(worklist_top(w));
+    fprintf(out, "\n");
+    worklist_insert(w, worklist_pop(w));
+    print_pops(what, w);
+}
+
+/* The pop order of each kind of worklist. */
+static void worklist(LLVMValueRef F)
+{
+    LLVMTypeRef Int32 = LLVMInt32TypeInContext(LLVMGetModuleContext(LLVMGetGlobalParent(F)));
+    LLVMBasicBlockRef bb;
+    LLVMValueRef I;
+    worklist_t w;
+    int i;
+
+    block_pops(F, "fifo", WORKLIST_FIFO);
+    block_pops(F, "lifo", WORKLIST_LIFO);
+    block_pops(F, "rpo", WORKLIST_RPO);
+
+    /* RPO puts the named instructions of a block right after it, however
+       they went in. */
+    w = worklist_create_ordered(WORKLIST_RPO, F);
+    for (bb = LLVMGetLastBasicBlock(F); bb != NULL; bb = LLVMGetPreviousBasicBlock(bb)) {
+        for (I = LLVMGetLastInstruction(bb); I != NULL; I = LLVMGetPreviousInstruction(I))
+            if (LLVMGetValueName(I)[0] != '\0')
+                worklist_insert(w, I);
+        worklist_insert(w, LLVMBasicBlockAsValue(bb));
+    }
+    print_pops("rpo values", w);
+
+    /* Popping 64 of 100 values compacts a FIFO; the order must survive
+       it, with the values inserted after it going last. */
+    w = worklist_create();
+    for (i = 0; i < 100; i++)
+        worklist_insert(w, LLVMConstInt(Int32, i, 0));
+    for (i = 0; i < 64; i++)
+        worklist_pop(w);
+    for (i = 100; i < 105; i++)
+        worklist_insert(w, LLVMConstInt(Int32, i, 0));
+    worklist_insert(w, LLVMConstInt(Int32, 70, 0));
+    worklist_insert(w, LLVMConstInt(Int32, 5, 0));
+    print_pops("fifo compacted", w);
+}
+
+int main(int argc, char **argv)
+{
+    LLVMContextRef Context = LLVMContextCreate();
+    LLVMMemoryBufferRef Buffer;
+    LLVMModuleRef Module;
+    LLVMValueRef F;
+    void (*test)(LLVMValueRef);
+    char *Message;
+
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s frontiers|cfg|worklist <input.ll> <output.txt>\n", argv[0]);
+        return 1;
+    }
+    if (strcmp(argv[1], "frontiers") == 0)
+        test = frontiers;
+    else if (strcmp(argv[1], "cfg") == 0)
+        test = cfg;
+    else if (strcmp(argv[1], "worklist") == 0)
+        test = worklist;
+    else {
+        fprintf(stderr, "%s: unknown test %s\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    if (LLVMCreateMemoryBufferWithContentsOfFile(argv[2], &Buffer, &Message)
+        || LLVMParseIRInContext(Context, Buffer, &Module, &Message)) {
+        fprintf(stderr, "%s: %s\n", argv[0], Message);
+        LLVMDisposeMessage(Message);
+        return 1;
+    }
+    if ((out = fopen(argv[3], "w")) == NULL) {
+        perror(argv[3]);
+        return 1;
+    }
+
+    for (F = LLVMGetFirstFunction(Module); F != NULL; F = LLVMGetNextFunction(F)) {
+        if (LLVMCountBasicBlocks(F) == 0)
+            continue;
+        fprintf(out, "function %s\n", LLVMGetValueName(F));
+        test(F);
+    }
+
+    fclose(out);
+    LLVMInvalidateDominators(NULL);
+    LLVMDisposeModule(Module);
+    LLVMContextDispose(Context);
+    return 0;
+}
@@ -0,0 +1,45 @@
+; ModuleID = 'cfg0'
+source_filename = "cfg0"
+
+; The switch reaches exit twice; the successors and predecessors keep
+; one entry per edge.
+define i32 @cfg0(i32 %n) {
+entry:
+  switch i32 %n, label %exit [ i32 0, label %loop
+                               i32 1, label %exit ]
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %odd = and i32 %i, 1
+  %c = icmp eq i32 %odd, 0
+  br i1 %c, label %even, label %latch
+
+even:
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 10
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i32 [ -1, %entry ], [ -1, %entry ], [ %i.next, %latch ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: function cfg0
+; CHECK-NEXT: succs(entry) = exit loop exit
+; CHECK-NEXT: preds(entry) =
+; CHECK-NEXT: domchildren(entry) = exit loop
+; CHECK-NEXT: succs(loop) = even latch
+; CHECK-NEXT: preds(loop) = latch entry
+; CHECK-NEXT: domchildren(loop) = even latch
+; CHECK-NEXT: succs(even) = latch
+; CHECK-NEXT: preds(even) = loop
+; CHECK-NEXT: domchildren(even) =
+; CHECK-NEXT: succs(latch) = exit loop
+; CHECK-NEXT: preds(latch) = even loop
+; CHECK-NEXT: domchildren(latch) =
+; CHECK-NEXT: succs(exit) =
+; CHECK-NEXT: preds(exit) = latch entry entry
+; CHECK-NEXT: domchildren(exit) =
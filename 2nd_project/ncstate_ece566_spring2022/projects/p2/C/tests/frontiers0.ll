@@ -0,0 +1,68 @@
+; ModuleID = 'frontiers0'
+source_filename = "frontiers0"
+
+; A diamond in a loop, so the frontier of an arm (join) differs from its
+; closure (join and loop). %x is stored before the loop, in one arm and
+; at the join, so its phis go at join and loop.
+define i32 @frontiers0(i1 %c, i32 %n) {
+entry:
+  %x = alloca i32, align 4
+  %i = alloca i32, align 4
+  store i32 0, i32* %x, align 4
+  store i32 0, i32* %i, align 4
+  br label %loop
+
+loop:
+  %iv = load i32, i32* %i, align 4
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 1, i32* %x, align 4
+  br label %join
+
+else:
+  br label %join
+
+join:
+  %xv = load i32, i32* %x, align 4
+  %xs = add i32 %xv, %iv
+  store i32 %xs, i32* %x, align 4
+  %inc = add i32 %iv, 1
+  store i32 %inc, i32* %i, align 4
+  %more = icmp slt i32 %inc, %n
+  br i1 %more, label %loop, label %exit
+
+exit:
+  %r = load i32, i32* %x, align 4
+  ret i32 %r
+}
+
+; CHECK-LABEL: function frontiers0
+; CHECK-NEXT: DF(entry) =
+; CHECK-NEXT: DF+(entry) =
+; CHECK-NEXT: PDF(entry) =
+; CHECK-NEXT: PDF+(entry) =
+; CHECK-NEXT: DF(loop) = loop
+; CHECK-NEXT: DF+(loop) = loop
+; CHECK-NEXT: PDF(loop) = join
+; CHECK-NEXT: PDF+(loop) = join
+; CHECK-NEXT: DF(then) = join
+; CHECK-NEXT: DF+(then) = loop join
+; CHECK-NEXT: PDF(then) = loop
+; CHECK-NEXT: PDF+(then) = loop join
+; CHECK-NEXT: DF(else) = join
+; CHECK-NEXT: DF+(else) = loop join
+; CHECK-NEXT: PDF(else) = loop
+; CHECK-NEXT: PDF+(else) = loop join
+; CHECK-NEXT: DF(join) = loop
+; CHECK-NEXT: DF+(join) = loop
+; CHECK-NEXT: PDF(join) = join
+; CHECK-NEXT: PDF+(join) = join
+; CHECK-NEXT: DF(exit) =
+; CHECK-NEXT: DF+(exit) =
+; CHECK-NEXT: PDF(exit) =
+; CHECK-NEXT: PDF+(exit) =
+; CHECK-NEXT: IDF(x) = loop join
+; CHECK-NEXT: IPDF(x) = loop join
+; CHECK-NEXT: IDF(i) = loop
+; CHECK-NEXT: IPDF(i) = join
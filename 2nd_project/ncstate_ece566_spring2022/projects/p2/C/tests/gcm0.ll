@@ -0,0 +1,33 @@
+; ModuleID = 'gcm0'
+; CHECK-LABEL: source_filename = "gcm0"
+source_filename = "gcm0"
+
+; CHECK-LABEL: @gcm0(i32 %0, i32 %1, i1 %2)
+define i32 @gcm0(i32 %0, i32 %1, i1 %2) {
+; CHECK: entry:
+; CHECK-NEXT: shl i32 %0, 3
+; CHECK-NEXT: br i1 %2
+entry:
+  %x = mul i32 %0, %1
+  %y = add i32 %x, 7
+  br i1 %2, label %cold, label %loop
+
+; CHECK: cold:
+; CHECK-NEXT: mul i32 %0, %1
+; CHECK-NEXT: add i32 %x, 7
+cold:
+  ret i32 %y
+
+; CHECK: loop:
+; CHECK-NOT: shl
+; CHECK: exit:
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %z = shl i32 %0, 3
+  %i.next = add i32 %i, %z
+  %c = icmp slt i32 %i.next, 1000
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %i.next
+}
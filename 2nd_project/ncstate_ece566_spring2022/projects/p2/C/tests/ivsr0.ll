@@ -0,0 +1,36 @@
+; ModuleID = 'ivsr0'
+; CHECK-LABEL: source_filename = "ivsr0"
+source_filename = "ivsr0"
+
+; CHECK-LABEL: @ivsr0(i32* %0, i32 %1)
+define void @ivsr0(i32* %0, i32 %1) {
+; CHECK: entry:
+; CHECK: shl i32
+; CHECK: br label %header
+entry:
+  br label %header
+
+; CHECK: header:
+; CHECK-DAG: %idx = phi i64 [ 0, %entry ], [ [[IDXN:%.*]], %header ]
+; CHECK-DAG: %s = phi i32 [ {{%.*}}, %entry ], [ [[SN:%.*]], %header ]
+; CHECK-NOT: mul
+; CHECK-NOT: shl
+; CHECK-NOT: sext
+; CHECK: getelementptr i32, i32* %0, i64 %idx
+; CHECK-DAG: [[SN]] = add i32 %s,
+; CHECK-DAG: [[IDXN]] = add i64 %idx, 1
+; CHECK: br i1
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %header ]
+  %idx = sext i32 %i to i64
+  %p = getelementptr i32, i32* %0, i64 %idx
+  %m = mul i32 %i, %1
+  %s = shl i32 %m, 2
+  store i32 %s, i32* %p, align 4
+  %i.next = add nsw i32 %i, 1
+  %c = icmp slt i32 %i.next, 100
+  br i1 %c, label %header, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,62 @@
+; ModuleID = 'licm0'
+; CHECK-LABEL: source_filename = "licm0"
+source_filename = "licm0"
+
+@G = global i32 5
+
+; CHECK-LABEL: @licm0(i32 %0, i32 %1, i32* %2)
+define i32 @licm0(i32 %0, i32 %1, i32* %2) {
+; CHECK: entry:
+; CHECK-DAG: load i32, i32* @G
+; CHECK-DAG: mul i32 %0, %1
+; CHECK: br label %header
+entry:
+  %S = alloca i32, align 4
+  store i32 0, i32* %S, align 4
+  br label %header
+
+; CHECK: header:
+; CHECK-NOT: mul
+; CHECK-NOT: load i32, i32* @G
+; CHECK: load i32, i32* %S
+; CHECK: exit:
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %header ]
+  %m = mul i32 %0, %1
+  %g = load i32, i32* @G, align 4
+  %s = load i32, i32* %S, align 4
+  %t = add i32 %m, %g
+  %s.next = add i32 %s, %t
+  store i32 %s.next, i32* %S, align 4
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, 100
+  br i1 %c, label %header, label %exit
+
+exit:
+  %r = load i32, i32* %S, align 4
+  ret i32 %r
+}
+
+@A = global [16 x i32] zeroinitializer
+@Out = global i32 0
+
+; A loop with no exit may never reach the guarded load, so it stays put.
+; CHECK-LABEL: @licm_noexit(i64 %0, i1 %1)
+define void @licm_noexit(i64 %0, i1 %1) {
+; CHECK: entry:
+; CHECK-NOT: load
+; CHECK: br label %header
+entry:
+  br label %header
+
+; CHECK: then:
+; CHECK: load i32, i32* %p
+header:
+  %p = getelementptr [16 x i32], [16 x i32]* @A, i64 0, i64 %0
+  br i1 %1, label %then, label %header
+
+then:
+  %v = load i32, i32* %p, align 4
+  store i32 %v, i32* @Out, align 4
+  br label %header
+}
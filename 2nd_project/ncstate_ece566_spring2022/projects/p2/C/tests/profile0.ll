@@ -0,0 +1,29 @@
+; ModuleID = 'profile0'
+; CHECK-LABEL: source_filename = "profile0"
+source_filename = "profile0"
+
+; Four blocks and the exit node have six edges, including exit->entry;
+; a spanning tree covers four of them, so two get counters.
+; CHECK: @__p2_edge_counters = internal global [2 x i64] zeroinitializer
+; CHECK: @llvm.global_dtors = appending global {{.*}} @__p2_profile_dump
+
+; CHECK-LABEL: @profile0(i1 %0)
+define i32 @profile0(i1 %0) {
+entry:
+  br i1 %0, label %then, label %else
+
+then:
+  br label %join
+
+else:
+  br label %join
+
+join:
+  %r = phi i32 [ 1, %then ], [ 2, %else ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: define internal void @__p2_profile_dump()
+; CHECK: call i8* @fopen
+; CHECK: call i32 (i8*, i8*, ...) @fprintf
+; CHECK: call i32 @fclose
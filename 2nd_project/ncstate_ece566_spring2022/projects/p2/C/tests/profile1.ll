@@ -0,0 +1,47 @@
+; ModuleID = 'profile1'
+; CHECK-LABEL: source_filename = "profile1"
+source_filename = "profile1"
+
+; GCM builds the dominator tree; splitting the critical edges for the
+; counters updates it in place, and p2 checks it against a fresh tree
+; before writing the output.
+; CHECK: @__p2_edge_counters = internal global [4 x i64] zeroinitializer
+
+; CHECK-LABEL: @profile1(i1 %0, i32 %1, i32 %2)
+define i32 @profile1(i1 %0, i32 %1, i32 %2) {
+; CHECK: entry:
+; CHECK-NOT: mul
+; CHECK: br i1 %0, label %join, label %else
+entry:
+  %x = mul i32 %1, %2
+  br i1 %0, label %join, label %else
+
+else:
+  br label %join
+
+; Both switch edges to exit are critical; after the first is split exit
+; still has an edge from join, so only the second split deletes it.
+; CHECK: join:
+; CHECK: switch i32 %1, label %[[D:join.exit_crit_edge[0-9]*]] [
+; CHECK-NEXT: i32 0, label %[[Z:join.exit_crit_edge[0-9]*]]
+; CHECK-NEXT: i32 1, label %join2
+join:
+  %r = phi i32 [ 1, %entry ], [ 2, %else ]
+  switch i32 %1, label %exit [ i32 0, label %exit
+                               i32 1, label %join2 ]
+
+; CHECK-DAG: [[Z]]:
+; CHECK-DAG: [[D]]:
+; CHECK: join2:
+; CHECK: mul i32 %1, %2
+; CHECK-NEXT: add i32 %x, %r
+join2:
+  %y = add i32 %x, %r
+  br label %exit
+
+; CHECK: exit:
+; CHECK-NEXT: phi i32 [ %r, %[[D]] ], [ %r, %[[Z]] ], [ %y, %join2 ]
+exit:
+  %s = phi i32 [ %r, %join ], [ %r, %join ], [ %y, %join2 ]
+  ret i32 %s
+}
@@ -0,0 +1,38 @@
+; ModuleID = 'profile2'
+; CHECK-LABEL: source_filename = "profile2"
+source_filename = "profile2"
+
+; The counts in profile2.prof are what -do-profile recorded for
+; profile2(17): of 17 iterations, 9 take the even branch and 8 skip it.
+; -use-profile solves the uncounted edges from them.
+
+; CHECK-LABEL: @profile2(i32 %n)
+define i32 @profile2(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %latch ]
+  %odd = and i32 %i, 1
+  %c = icmp eq i32 %odd, 0
+; CHECK: br i1 %c, label %even, label %latch, !prof [[EVEN:![0-9]+]]
+  br i1 %c, label %even, label %latch
+
+even:
+  %t = add i32 %s, %i
+  br label %latch
+
+latch:
+  %s.next = phi i32 [ %t, %even ], [ %s, %loop ]
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+; CHECK: br i1 %done, label %exit, label %loop, !prof [[EXIT:![0-9]+]]
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %s.next
+}
+
+; CHECK-DAG: [[EVEN]] = !{!"branch_weights", i32 9, i32 8}
+; CHECK-DAG: [[EXIT]] = !{!"branch_weights", i32 1, i32 16}
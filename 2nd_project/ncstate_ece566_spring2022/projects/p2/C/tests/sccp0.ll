@@ -0,0 +1,46 @@
+; ModuleID = 'sccp0'
+; CHECK-LABEL: source_filename = "sccp0"
+source_filename = "sccp0"
+
+; CHECK-LABEL: @sccp0(i32 %0)
+define i32 @sccp0(i32 %0) {
+; CHECK: entry:
+; CHECK-NEXT: br label %then
+; CHECK-NOT: else:
+entry:
+  %x = add i32 2, 3
+  %c = icmp eq i32 %x, 5
+  br i1 %c, label %then, label %else
+
+then:
+  %y = mul i32 %x, 2
+  br label %join
+
+else:
+  %z = add i32 %0, 1
+  br label %join
+
+; CHECK: join:
+; CHECK-NOT: phi
+; CHECK-NEXT: ret i32 10
+join:
+  %r = phi i32 [ %y, %then ], [ %z, %else ]
+  ret i32 %r
+}
+
+; A select on a constant is its arm, and one with equal arms is either,
+; even when that arm varies.
+; CHECK-LABEL: @sccp_select(i8 %0, i8* %1)
+define i8 @sccp_select(i8 %0, i8* %1) {
+; CHECK: entry:
+; CHECK-NOT: select
+; CHECK: %v = load i8, i8* %1
+; CHECK-NEXT: %r = add i8 -19, %v
+entry:
+  %a = select i1 true, i8 -19, i8 %0
+  %c = icmp eq i8 %0, 0
+  %p = select i1 %c, i8* %1, i8* %1
+  %v = load i8, i8* %p, align 1
+  %r = add i8 %a, %v
+  ret i8 %r
+}
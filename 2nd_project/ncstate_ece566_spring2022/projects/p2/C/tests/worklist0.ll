@@ -0,0 +1,36 @@
+; ModuleID = 'worklist0'
+source_filename = "worklist0"
+
+; The layout order (entry exit latch loop dead) is not the reverse
+; post-order (entry loop latch exit), and dead is unreachable, so RPO
+; pops it last.
+define i32 @worklist0(i32 %n) {
+entry:
+  br label %loop
+
+exit:
+  %r = phi i32 [ %i.next, %latch ]
+  ret i32 %r
+
+latch:
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  br label %latch
+
+dead:
+  ret i32 0
+}
+
+; CHECK-LABEL: function worklist0
+; CHECK-NEXT: fifo first = entry
+; CHECK-NEXT: fifo = exit latch loop dead entry
+; CHECK-NEXT: lifo first = dead
+; CHECK-NEXT: lifo = dead loop latch exit entry
+; CHECK-NEXT: rpo first = entry
+; CHECK-NEXT: rpo = entry loop latch exit dead
+; CHECK-NEXT: rpo values = entry loop i latch i.next done exit r dead
+; CHECK-NEXT: fifo compacted = 64 65 66 67 68 69 70 71 72 73 74 75 76 77 78 79 80 81 82 83 84 85 86 87 88 89 90 91 92 93 94 95 96 97 98 99 100 101 102 103 104 5
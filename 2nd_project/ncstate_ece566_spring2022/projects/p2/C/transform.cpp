@@ -18,6 +18,8 @@
 #include "llvm/IR/Type.h"
 
 #include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/Transforms/Utils/Local.h"
 
 #include "dominance.h"
 #include "transform.h"
@@ -31,3 +33,36 @@ LLVMValueRef InstructionSimplify(LLVMValueRef I)
   const Module* M = II->getModule();
   return wrap( SimplifyInstruction((Instruction*)unwrap(I), M->getDataLayout() ));
 }
+
+LLVMValueRef LLVMConstantFoldWithOperands(LLVMValueRef I, LLVMValueRef *Ops)
+{
+  Instruction *II = (Instruction*)unwrap(I);
+  const DataLayout &DL = II->getModule()->getDataLayout();
+  SmallVector<Constant*,4> Constants;
+  for (unsigned i = 0; i < II->getNumOperands(); i++)
+    Constants.push_back(cast<Constant>(unwrap(Ops[i])));
+
+  if (CmpInst *Cmp = dyn_cast<CmpInst>(II))
+    return wrap(ConstantFoldCompareInstOperands(Cmp->getPredicate(),
+                                                Constants[0], Constants[1], DL));
+  return wrap(ConstantFoldInstOperands(II, Constants, DL));
+}
+
+LLVMBool LLVMHasNoSignedWrap(LLVMValueRef I)
+{
+  OverflowingBinaryOperator *Op = dyn_cast<OverflowingBinaryOperator>(unwrap(I));
+  return Op != NULL && Op->hasNoSignedWrap();
+}
+
+LLVMBool LLVMConstantFoldTerminator(LLVMBasicBlockRef BB)
+{
+  return ConstantFoldTerminator(unwrap(BB), true);
+}
+
+unsigned LLVMRemoveUnreachableBlocks(LLVMValueRef Fun)
+{
+  Function *F = unwrap<Function>(Fun);
+  size_t Before = F->size();
+  removeUnreachableBlocks(*F);
+  return Before - F->size();
+}
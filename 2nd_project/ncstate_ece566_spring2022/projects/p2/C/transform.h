@@ -17,6 +17,24 @@ extern "C" {
 
 LLVMValueRef InstructionSimplify(LLVMValueRef I);
 
+/* The constant I computes when its operands are the constants Ops, one
+   per operand; NULL if it does not fold (e.g. a load or a call). The
+   result may still be a constant expression. */
+LLVMValueRef LLVMConstantFoldWithOperands(LLVMValueRef I, LLVMValueRef *Ops);
+
+/* The nsw flag of an add, sub, mul or shl, which the C API cannot read. */
+LLVMBool LLVMHasNoSignedWrap(LLVMValueRef I);
+
+/* Replace a branch or switch on a constant with a branch to the one
+   successor it takes, dropping the phi entries of the others; true if it
+   changed. Change the CFG this way, and remove blocks with the call
+   below, only followed by LLVMInvalidateDominators. */
+LLVMBool LLVMConstantFoldTerminator(LLVMBasicBlockRef BB);
+
+/* Delete the blocks of Fun no path from its entry reaches; returns how
+   many there were. */
+unsigned LLVMRemoveUnreachableBlocks(LLVMValueRef Fun);
+
 
 #ifdef __cplusplus
 }
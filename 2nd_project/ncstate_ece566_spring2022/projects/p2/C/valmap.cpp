@@ -50,8 +50,9 @@ void *valmap_find(valmap_t map, LLVMValueRef v)
   ValueMap<Value*,void*> *vmap = (ValueMap<Value*,void*>*)map;
   Value *val = unwrap(v);
   
-  if(vmap->find(val)==vmap->end())
+  ValueMap<Value*,void*>::iterator it = vmap->find(val);
+  if(it==vmap->end())
     return NULL;
  
-  return (*vmap)[val];
+  return it->second;
 }
@@ -4,85 +4,192 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/BasicBlock.h"
-#include <set>
+#include <algorithm>
+#include <vector>
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/InstIterator.h"
 #include "worklist.h"
 
 using namespace llvm;
 
-typedef std::set<Value*> worklist_internal;
+/* A worklist keeps its values in a vector, and a set of the values in it
+   for O(1) membership tests, so inserts only allocate when the vector or
+   the set grows. FIFO pops from Head, LIFO from the back, and RPO keeps
+   Items as a heap ordered by Rank. */
+struct worklist_internal {
+  worklist_order_t Order;
+  std::vector<Value*> Items;
+  size_t Head;
+  DenseSet<Value*> InList;
+  DenseMap<Value*,unsigned> Rank;
+
+  worklist_internal(worklist_order_t Order) : Order(Order), Head(0) {}
+
+  /* Values outside the function's RPO, e.g. unreachable blocks, come
+     last. */
+  unsigned rank(Value *V) const
+  {
+    auto it = Rank.find(V);
+    return it == Rank.end() ? ~0U : it->second;
+  }
+
+  /* std::*_heap keep the largest element first; we want the lowest
+     rank. */
+  bool later(Value *A, Value *B) const
+  {
+    return rank(A) > rank(B);
+  }
+};
+
+static worklist_internal *unwrapList(worklist_t w)
+{
+  return (worklist_internal*)w;
+}
+
 /* Create an empty worklist */
 worklist_t worklist_create()
 {
-  worklist_internal *list = new std::set<Value*>();
+  return worklist_create_ordered(WORKLIST_FIFO, NULL);
+}
+
+worklist_t worklist_create_ordered(worklist_order_t order, LLVMValueRef F)
+{
+  worklist_internal *list = new worklist_internal(order);
+
+  if (order == WORKLIST_RPO)
+    {
+      /* Number blocks in reverse post-order and the instructions of a
+         block right after the block itself. */
+      Function *Fun = unwrap<Function>(F);
+      unsigned next = 0;
+      ReversePostOrderTraversal<Function*> RPOT(Fun);
+      for (BasicBlock *BB : RPOT)
+        {
+          list->Rank[BB] = next++;
+          for (Instruction &I : *BB)
+            list->Rank[&I] = next++;
+        }
+    }
+
   return (worklist_t) list;
 }
 
 void worklist_destroy(worklist_t w)
 {
-  worklist_internal *list = new worklist_internal();
-  delete list;
+  delete unwrapList(w);
 }
 
 worklist_t worklist_for_function(LLVMValueRef F)
 {
   Function *Fun = unwrap<Function>(F);
-  worklist_internal *list = new worklist_internal();
+  worklist_t list = worklist_create();
   
   for (inst_iterator I = inst_begin(Fun), E = inst_end(Fun); I != E; ++I)
-    list->insert(&*I);
+    worklist_insert(list, wrap(&*I));
   
-  return (worklist_t) list;
+  return list;
 }
 
 worklist_t worklist_for_basicblock(LLVMBasicBlockRef BBRef)
 {
   BasicBlock *BB = unwrap(BBRef);
   BasicBlock::iterator I,E;
-  worklist_internal *list = new worklist_internal();
+  worklist_t list = worklist_create();
   for(I=BB->begin(),E=BB->end(); I!=E; I++)
     {
-      list->insert(&*I);
+      worklist_insert(list, wrap(&*I));
     }
-  return (worklist_t) list;
+  return list;
 }
 
 /* Insert a new value into worklist */
 void worklist_insert(worklist_t w, LLVMValueRef val)
 {
-  worklist_internal *list = (worklist_internal*)w;
-  list->insert(unwrap(val));
+  worklist_internal *list = unwrapList(w);
+  Value *V = unwrap(val);
+  if (!list->InList.insert(V).second)
+    return;
+
+  list->Items.push_back(V);
+  if (list->Order == WORKLIST_RPO)
+    std::push_heap(list->Items.begin(), list->Items.end(),
+                   [list](Value *A, Value *B) { return list->later(A, B); });
+}
+
+/* Check if val is waiting in the worklist */
+LLVMBool worklist_contains(worklist_t w, LLVMValueRef val)
+{
+  worklist_internal *list = unwrapList(w);
+  return (LLVMBool)list->InList.count(unwrap(val));
 }
 
 /* Check if empty */
 LLVMBool worklist_empty(worklist_t w)
 {
-  worklist_internal *list = (worklist_internal*)w;
-  return (LLVMBool)list->empty();
+  worklist_internal *list = unwrapList(w);
+  return (LLVMBool)list->InList.empty();
 }
 
 /* Get next data to pop */
 LLVMValueRef worklist_top(worklist_t w)
 {
-  worklist_internal *list = (worklist_internal*)w;
-  worklist_internal::iterator i = list->begin();
-  if(i!=list->end())
-    return wrap(*i);
-  else
+  worklist_internal *list = unwrapList(w);
+  if (list->InList.empty())
     return NULL;
+
+  switch (list->Order)
+    {
+    case WORKLIST_FIFO:
+      return wrap(list->Items[list->Head]);
+    case WORKLIST_LIFO:
+      return wrap(list->Items.back());
+    case WORKLIST_RPO:
+      return wrap(list->Items.front());
+    }
+  return NULL;
 }
 
 /* Get and remove top from list */
 LLVMValueRef worklist_pop(worklist_t w)
 {
-  worklist_internal *list = (worklist_internal*)w;
-  worklist_internal::iterator i =list->begin();
-  if(i!=list->end())
+  worklist_internal *list = unwrapList(w);
+  if (list->InList.empty())
+    return NULL;
+
+  Value *V;
+  switch (list->Order)
     {
-      LLVMValueRef ret = wrap(*i);
-      list->erase(i);
-      return ret;
+    case WORKLIST_FIFO:
+      V = list->Items[list->Head++];
+      /* Reuse the vector once it drains, and drop the popped prefix once
+         it is most of the vector. */
+      if (list->Head == list->Items.size())
+        {
+          list->Items.clear();
+          list->Head = 0;
+        }
+      else if (list->Head >= 64 && 2 * list->Head >= list->Items.size())
+        {
+          list->Items.erase(list->Items.begin(), list->Items.begin() + list->Head);
+          list->Head = 0;
+        }
+      break;
+    case WORKLIST_LIFO:
+      V = list->Items.back();
+      list->Items.pop_back();
+      break;
+    case WORKLIST_RPO:
+    default:
+      std::pop_heap(list->Items.begin(), list->Items.end(),
+                    [list](Value *A, Value *B) { return list->later(A, B); });
+      V = list->Items.back();
+      list->Items.pop_back();
+      break;
     }
-  else
-    return NULL;
+
+  list->InList.erase(V);
+  return wrap(V);
 }
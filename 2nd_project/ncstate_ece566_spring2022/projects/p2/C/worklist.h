@@ -17,9 +17,22 @@ extern "C" {
 
 typedef void * worklist_t;
 
-/* Create an empty worklist */
+/* The order in which values leave a worklist. A value already in the
+   worklist is not inserted again, so each is popped at most once per
+   insertion. */
+typedef enum {
+  WORKLIST_FIFO,    /* insertion order */
+  WORKLIST_LIFO,    /* most recently inserted first */
+  WORKLIST_RPO      /* blocks and instructions in reverse post-order */
+} worklist_order_t;
+
+/* Create an empty FIFO worklist */
 worklist_t worklist_create();
 
+/* Create an empty worklist with the given order. WORKLIST_RPO ranks the
+   blocks and instructions of Function, which may be NULL otherwise. */
+worklist_t worklist_create_ordered(worklist_order_t order, LLVMValueRef Function);
+
 void worklist_destroy(worklist_t);
 worklist_t worklist_for_function(LLVMValueRef Function);
 worklist_t worklist_for_basicblock(LLVMBasicBlockRef BasicBlock);
@@ -27,6 +40,9 @@ worklist_t worklist_for_basicblock(LLVMBasicBlockRef BasicBlock);
 /* Insert a new value into worklist */
 void worklist_insert(worklist_t w, LLVMValueRef val);
 
+/* Check if val is waiting in the worklist, in O(1) */
+LLVMBool worklist_contains(worklist_t w, LLVMValueRef val);
+
 /* Check if empty */
 LLVMBool worklist_empty(worklist_t w);
 